@@ -1,339 +1,4760 @@
 #include <iostream>
-#include <stack>
 #include <queue>
 #include <string>
 #include <list>
 #include <map>
+#include <vector>
+#include <cstdint>
+#include <cctype>
+#include <cmath>
+#include <climits>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <new>
+#include <utility>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <filesystem>
+#include <chrono>
+#include <string_view>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <shared_mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <charconv>
+#include <random>
+#include <iomanip>
+#include <sstream>
+#if defined(__unix__) || defined(__APPLE__)
+#define SMS_POSIX_IO
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#endif
 using namespace std;
 
+// Object Pool Class
+// Slab allocator for fixed-size records; freed slots are recycled through a free list.
+// The owner must destroy live objects before the pool goes away.
+template <typename T, size_t SlabSize = 1024>
+class ObjectPool {
+private:
+    union Slot {
+        Slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    vector<Slot*> slabs;
+    Slot* freeList;
+    size_t live;
+
+    void addSlab() {
+        Slot* slab = static_cast<Slot*>(::operator new(sizeof(Slot) * SlabSize));
+        slabs.push_back(slab);
+        for (size_t i = SlabSize; i-- > 0;) {
+            slab[i].next = freeList;
+            freeList = &slab[i];
+        }
+    }
+
+public:
+    ObjectPool() : freeList(nullptr), live(0) {}
+
+    ~ObjectPool() {
+        for (Slot* slab : slabs) ::operator delete(slab);
+    }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    size_t size() const { return live; }
+    size_t capacity() const { return slabs.size() * SlabSize; }
+
+    // Pre-allocate slabs for at least count live objects
+    void reserve(size_t count) {
+        while (capacity() < count) addSlab();
+    }
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        if (!freeList) addSlab();
+        Slot* slot = freeList;
+        freeList = slot->next;
+        T* object = new (slot->storage) T(std::forward<Args>(args)...);
+        live++;
+        return object;
+    }
+
+    void destroy(T* object) {
+        object->~T();
+        Slot* slot = reinterpret_cast<Slot*>(object);
+        slot->next = freeList;
+        freeList = slot;
+        live--;
+    }
+};
+
+// Small Vector Class
+// Contiguous array that keeps up to InlineCapacity elements inside the object and only
+// moves to the heap when it grows past that.
+template <typename T, size_t InlineCapacity = 16>
+class SmallVector {
+private:
+    alignas(T) unsigned char inlineStorage[sizeof(T) * InlineCapacity];
+    T* items;
+    size_t count;
+    size_t allocated;
+
+    bool onHeap() const { return items != reinterpret_cast<const T*>(inlineStorage); }
+
+    void grow() {
+        size_t newCapacity = allocated * 2;
+        T* moved = static_cast<T*>(::operator new(sizeof(T) * newCapacity));
+        for (size_t i = 0; i < count; i++) {
+            new (moved + i) T(std::move(items[i]));
+            items[i].~T();
+        }
+        if (onHeap()) ::operator delete(items);
+        items = moved;
+        allocated = newCapacity;
+    }
+
+public:
+    SmallVector() : items(reinterpret_cast<T*>(inlineStorage)), count(0), allocated(InlineCapacity) {}
+
+    ~SmallVector() {
+        clear();
+        if (onHeap()) ::operator delete(items);
+    }
+
+    SmallVector(const SmallVector&) = delete;
+    SmallVector& operator=(const SmallVector&) = delete;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    T& operator[](size_t i) { return items[i]; }
+    const T& operator[](size_t i) const { return items[i]; }
+    T& back() { return items[count - 1]; }
+
+    T* begin() { return items; }
+    T* end() { return items + count; }
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+
+    void push_back(T&& value) {
+        if (count == allocated) grow();
+        new (items + count) T(std::move(value));
+        count++;
+    }
+
+    void pop_back() {
+        items[--count].~T();
+    }
+
+    void clear() {
+        while (count) pop_back();
+    }
+};
+
+// Indexed Min-Heap Class
+// Binary min-heap of (key, priority) pairs with a key -> position index, so a key's
+// priority can be changed or the key removed in O(log n) without rebuilding the heap.
+class IndexedMinHeap {
+public:
+    struct Entry {
+        int key;
+        int64_t priority;
+    };
+
+private:
+    vector<Entry> heap;
+    unordered_map<int, uint32_t> position;
+
+    void place(size_t slot, const Entry& entry) {
+        heap[slot] = entry;
+        position[entry.key] = (uint32_t)slot;
+    }
+
+    void siftUp(size_t slot) {
+        Entry entry = heap[slot];
+        while (slot > 0) {
+            size_t parent = (slot - 1) / 2;
+            if (heap[parent].priority <= entry.priority) break;
+            place(slot, heap[parent]);
+            slot = parent;
+        }
+        place(slot, entry);
+    }
+
+    void siftDown(size_t slot) {
+        Entry entry = heap[slot];
+        while (true) {
+            size_t child = 2 * slot + 1;
+            if (child >= heap.size()) break;
+            if (child + 1 < heap.size() && heap[child + 1].priority < heap[child].priority) child++;
+            if (entry.priority <= heap[child].priority) break;
+            place(slot, heap[child]);
+            slot = child;
+        }
+        place(slot, entry);
+    }
+
+public:
+    void reserve(size_t count) {
+        heap.reserve(count);
+        position.reserve(count);
+    }
+
+    size_t size() const { return heap.size(); }
+    bool empty() const { return heap.empty(); }
+    const Entry& top() const { return heap.front(); }
+
+    const Entry* find(int key) const {
+        auto found = position.find(key);
+        return found == position.end() ? nullptr : &heap[found->second];
+    }
+
+    // Insert keys not yet in the heap, all at once: O(n) heapify instead of n sifts
+    void insertAll(const vector<Entry>& entries) {
+        heap.insert(heap.end(), entries.begin(), entries.end());
+        make_heap(heap.begin(), heap.end(), [](const Entry& a, const Entry& b) { return a.priority > b.priority; });
+        position.reserve(heap.size());
+        for (size_t slot = 0; slot < heap.size(); slot++) position[heap[slot].key] = (uint32_t)slot;
+    }
+
+    // Insert key, or move it to its new priority
+    void set(int key, int64_t priority) {
+        auto found = position.find(key);
+        if (found == position.end()) {
+            heap.push_back({key, priority});
+            position.emplace(key, (uint32_t)(heap.size() - 1));
+            siftUp(heap.size() - 1);
+            return;
+        }
+        size_t slot = found->second;
+        int64_t previous = heap[slot].priority;
+        heap[slot].priority = priority;
+        if (priority < previous) {
+            siftUp(slot);
+        } else {
+            siftDown(slot);
+        }
+    }
+
+    bool erase(int key) {
+        auto found = position.find(key);
+        if (found == position.end()) return false;
+        size_t slot = found->second;
+        position.erase(found);
+        Entry last = heap.back();
+        heap.pop_back();
+        if (slot < heap.size()) {
+            place(slot, last);
+            siftUp(slot);
+            siftDown(position[last.key]);
+        }
+        return true;
+    }
+
+    // Visit every entry with priority below limit (in no particular order), skipping
+    // whole subtrees at or above it: O(number visited)
+    template <typename Visitor>
+    void forEachBelow(int64_t limit, Visitor visit) const {
+        vector<size_t> pending;
+        if (!heap.empty()) pending.push_back(0);
+        while (!pending.empty()) {
+            size_t slot = pending.back();
+            pending.pop_back();
+            if (heap[slot].priority >= limit) continue;
+            visit(heap[slot]);
+            if (2 * slot + 1 < heap.size()) pending.push_back(2 * slot + 1);
+            if (2 * slot + 2 < heap.size()) pending.push_back(2 * slot + 2);
+        }
+    }
+
+    // The count lowest entries in ascending order, read without modifying the heap:
+    // O(count log count), independent of the heap size
+    vector<Entry> lowest(size_t count) const {
+        vector<Entry> result;
+        auto later = [this](size_t a, size_t b) { return heap[a].priority > heap[b].priority; };
+        priority_queue<size_t, vector<size_t>, decltype(later)> frontier(later);
+        if (!heap.empty()) frontier.push(0);
+        while (!frontier.empty() && result.size() < count) {
+            size_t slot = frontier.top();
+            frontier.pop();
+            result.push_back(heap[slot]);
+            if (2 * slot + 1 < heap.size()) frontier.push(2 * slot + 1);
+            if (2 * slot + 2 < heap.size()) frontier.push(2 * slot + 2);
+        }
+        return result;
+    }
+
+    // Every entry, in heap order
+    const vector<Entry>& entries() const { return heap; }
+};
+
+// Rounding modes for Money::applyRate
+enum class Rounding {
+    HALF_UP,    // Halves away from zero
+    HALF_EVEN,  // Halves to the even neighbour (banker's rounding)
+    DOWN,       // Toward zero
+    UP          // Away from zero
+};
+
+// Money Class
+// Currency amount in integer minor units (cents). Sums and quantity products are exact;
+// rounding only happens where a rate is applied, and the mode is chosen there. There is
+// no implicit conversion from double, so mixing raw floating-point prices in is a
+// compile error.
+class Money {
+private:
+    int64_t cents;
+
+    constexpr explicit Money(int64_t cents) : cents(cents) {}
+
+    // numerator / denominator (denominator > 0) rounded per mode
+    static constexpr int64_t divide(int64_t numerator, int64_t denominator, Rounding mode) {
+        // The common case: bias by half the denominator and truncate, one division and no branches
+        if (mode == Rounding::HALF_UP) return (numerator + (numerator < 0 ? -denominator : denominator) / 2) / denominator;
+        int64_t quotient = numerator / denominator;
+        int64_t remainder = numerator % denominator;
+        if (remainder == 0) return quotient;
+        int64_t away = numerator < 0 ? -1 : 1;
+        int64_t twice = 2 * (remainder < 0 ? -remainder : remainder);
+        switch (mode) {
+            case Rounding::DOWN:
+                return quotient;
+            case Rounding::UP:
+                return quotient + away;
+            case Rounding::HALF_UP:
+                return twice >= denominator ? quotient + away : quotient;
+            case Rounding::HALF_EVEN:
+                if (twice == denominator) return quotient % 2 ? quotient + away : quotient;
+                return twice > denominator ? quotient + away : quotient;
+        }
+        return quotient;
+    }
+
+public:
+    constexpr Money() : cents(0) {}
+
+    static constexpr Money fromCents(int64_t cents) { return Money(cents); }
+    // For prices typed in or parsed as decimals; rounds to the nearest cent
+    static Money fromDouble(double amount) { return Money(llround(amount * 100)); }
+
+    constexpr int64_t minorUnits() const { return cents; }
+    double toDouble() const { return cents / 100.0; }
+    constexpr bool isZero() const { return cents == 0; }
+
+    constexpr Money operator+(Money other) const { return Money(cents + other.cents); }
+    constexpr Money operator-(Money other) const { return Money(cents - other.cents); }
+    constexpr Money operator-() const { return Money(-cents); }
+    constexpr Money operator*(int64_t quantity) const { return Money(cents * quantity); }
+    Money& operator+=(Money other) { cents += other.cents; return *this; }
+    Money& operator-=(Money other) { cents -= other.cents; return *this; }
+
+    constexpr bool operator==(Money other) const { return cents == other.cents; }
+    constexpr bool operator!=(Money other) const { return cents != other.cents; }
+    constexpr bool operator<(Money other) const { return cents < other.cents; }
+    constexpr bool operator<=(Money other) const { return cents <= other.cents; }
+    constexpr bool operator>(Money other) const { return cents > other.cents; }
+    constexpr bool operator>=(Money other) const { return cents >= other.cents; }
+
+    // This amount times basisPoints / 10000 (e.g. 1500 for 15%)
+    constexpr Money applyRate(int64_t basisPoints, Rounding mode = Rounding::HALF_UP) const {
+        return Money(divide(cents * basisPoints, 10000, mode));
+    }
+
+    // This amount times a factor such as 0.85 or 1.20
+    Money scaled(double factor, Rounding mode = Rounding::HALF_UP) const {
+        return applyRate(llround(factor * 10000), mode);
+    }
+
+    string toString() const {
+        uint64_t magnitude = cents < 0 ? 0 - (uint64_t)cents : (uint64_t)cents;
+        string fraction = to_string(magnitude % 100);
+        return (cents < 0 ? "-" : "") + to_string(magnitude / 100) + (fraction.size() < 2 ? ".0" : ".") + fraction;
+    }
+
+    friend ostream& operator<<(ostream& out, Money amount) { return out << amount.toString(); }
+
+    friend istream& operator>>(istream& in, Money& amount) {
+        double typed;
+        if (in >> typed) amount = fromDouble(typed);
+        return in;
+    }
+};
+
+static_assert(Money::fromCents(250).applyRate(1000) == Money::fromCents(25), "10% of $2.50");
+static_assert(Money::fromCents(5).applyRate(5000, Rounding::HALF_UP) == Money::fromCents(3), "2.5 rounds up");
+static_assert(Money::fromCents(5).applyRate(5000, Rounding::HALF_EVEN) == Money::fromCents(2), "2.5 rounds to even");
+static_assert(Money::fromCents(-5).applyRate(5000, Rounding::HALF_UP) == Money::fromCents(-3), "halves round away from zero");
+static_assert(Money::fromCents(-1).applyRate(4999, Rounding::HALF_UP) == Money::fromCents(0), "below half rounds toward zero");
+static_assert(Money::fromCents(199).applyRate(5000, Rounding::DOWN) == Money::fromCents(99), "truncation");
+static_assert(Money::fromCents(199).applyRate(5000, Rounding::UP) == Money::fromCents(100), "ceiling");
+
+// Snapshot Buffer Class
+// Accumulates a snapshot section in native byte order; strings are length-prefixed
+class SnapshotBuffer {
+public:
+    vector<char> bytes;
+
+    void putBytes(const void* data, size_t length) {
+        const char* begin = static_cast<const char*>(data);
+        bytes.insert(bytes.end(), begin, begin + length);
+    }
+
+    template <typename T>
+    void put(const T& value) {
+        putBytes(&value, sizeof(T));
+    }
+
+    void putString(const string& text) {
+        put<uint32_t>((uint32_t)text.size());
+        putBytes(text.data(), text.size());
+    }
+
+    void putMoney(Money amount) {
+        put<int64_t>(amount.minorUnits());
+    }
+};
+
+// Snapshot Reader Class
+// Bounds-checked cursor over a mapped snapshot; every read returns false once the data runs out
+class SnapshotReader {
+private:
+    const char* cursor;
+    const char* end;
+
+public:
+    SnapshotReader(const char* data, size_t length) : cursor(data), end(data + length) {}
+
+    size_t remaining() const { return (size_t)(end - cursor); }
+
+    bool getBytes(void* out, size_t length) {
+        if (remaining() < length) return false;
+        memcpy(out, cursor, length);
+        cursor += length;
+        return true;
+    }
+
+    template <typename T>
+    bool get(T& value) {
+        return getBytes(&value, sizeof(T));
+    }
+
+    // Point data at the next length bytes instead of copying them
+    bool getSpan(const char*& data, size_t length) {
+        if (remaining() < length) return false;
+        data = cursor;
+        cursor += length;
+        return true;
+    }
+
+    bool getString(string& text) {
+        uint32_t length;
+        if (!get(length) || remaining() < length) return false;
+        text.assign(cursor, length);
+        cursor += length;
+        return true;
+    }
+
+    bool getMoney(Money& amount) {
+        int64_t cents;
+        if (!get(cents)) return false;
+        amount = Money::fromCents(cents);
+        return true;
+    }
+
+    // Split off the next length bytes as a reader of their own
+    bool sub(size_t length, SnapshotReader& section) {
+        if (remaining() < length) return false;
+        section = SnapshotReader(cursor, length);
+        cursor += length;
+        return true;
+    }
+};
+
+// Mapped File Class
+// Read-only view of a whole file: mmap on POSIX systems, a single buffered read elsewhere
+class MappedFile {
+private:
+    const char* bytes;
+    size_t length;
+#ifdef SMS_POSIX_IO
+    void* mapping;
+#else
+    vector<char> buffer;
+#endif
+
+public:
+    MappedFile() : bytes(nullptr), length(0)
+#ifdef SMS_POSIX_IO
+        , mapping(nullptr)
+#endif
+    {}
+
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const string& path) {
+        close();
+#ifdef SMS_POSIX_IO
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            return false;
+        }
+        length = (size_t)info.st_size;
+        if (length > 0) {
+            mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                mapping = nullptr;
+                length = 0;
+                ::close(fd);
+                return false;
+            }
+            bytes = static_cast<const char*>(mapping);
+        }
+        ::close(fd);
+        return true;
+#else
+        ifstream in(path, ios::binary | ios::ate);
+        if (!in) return false;
+        buffer.resize((size_t)in.tellg());
+        in.seekg(0);
+        if (!in.read(buffer.data(), (streamsize)buffer.size())) return false;
+        bytes = buffer.data();
+        length = buffer.size();
+        return true;
+#endif
+    }
+
+    void close() {
+#ifdef SMS_POSIX_IO
+        if (mapping) munmap(mapping, length);
+        mapping = nullptr;
+#else
+        buffer.clear();
+#endif
+        bytes = nullptr;
+        length = 0;
+    }
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+};
+
+// Write-Ahead Log Class
+// Append-only journal of mutations since the last snapshot. Records are buffered and
+// written in groups; a commit writes the group and fsyncs according to the policy.
+// File: [8-byte magic][uint32 version] then frames of
+// [uint32 payload length][uint64 sequence][uint8 type][uint32 checksum][payload]
+class WriteAheadLog {
+public:
+    enum RecordType : uint8_t {
+        ADD_PRODUCT = 1,
+        UPDATE_PRODUCT = 2,
+        REMOVE_PRODUCT = 3,
+        CATEGORIZE_PRODUCT = 4,
+        CHECKOUT = 5,
+        FULFILL_ORDER = 6,
+        ADD_CUSTOMER = 7,
+        UPDATE_REWARD_POINTS = 8,
+        SET_PROMOTION = 9
+    };
+
+    enum FsyncPolicy {
+        FSYNC_NONE,          // Leave flushing to the OS
+        FSYNC_EVERY_COMMIT,  // fsync after every group written
+        FSYNC_INTERVAL       // fsync at most once per interval
+    };
+
+private:
+    static constexpr char MAGIC[8] = {'S', 'M', 'S', 'W', 'A', 'L', '\0', '\0'};
+    static constexpr uint32_t VERSION = 4;  // 2: amounts are int64 cents; 3: SET_PROMOTION records; 4: absolute expiry days
+    static constexpr size_t FILE_HEADER = sizeof(MAGIC) + sizeof(VERSION);
+    static constexpr size_t FRAME_HEADER = sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint8_t) + sizeof(uint32_t);
+
+    FILE* file;
+    FsyncPolicy policy;
+    size_t groupSize;
+    chrono::milliseconds fsyncInterval;
+    chrono::steady_clock::time_point lastFsync;
+    vector<char> pending;
+    size_t pendingRecords;
+    uint64_t lastSequence;
+    mutex lock;  // Checkout lanes append concurrently
+
+    // FNV-1a over the record type and payload
+    static uint32_t checksum(uint8_t type, const char* payload, size_t length) {
+        uint32_t hash = 2166136261u;
+        hash = (hash ^ type) * 16777619u;
+        for (size_t i = 0; i < length; i++) {
+            hash = (hash ^ (unsigned char)payload[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    bool sync() {
+#ifdef SMS_POSIX_IO
+        if (fsync(fileno(file)) != 0) return false;
+#endif
+        lastFsync = chrono::steady_clock::now();
+        return true;
+    }
+
+    bool writeHeader() {
+        return fwrite(MAGIC, 1, sizeof(MAGIC), file) == sizeof(MAGIC) &&
+               fwrite(&VERSION, 1, sizeof(VERSION), file) == sizeof(VERSION) && fflush(file) == 0;
+    }
+
+public:
+    WriteAheadLog()
+        : file(nullptr), policy(FSYNC_EVERY_COMMIT), groupSize(64), fsyncInterval(100),
+          pendingRecords(0), lastSequence(0) {}
+
+    ~WriteAheadLog() { close(); }
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Open for appending. validLength drops a torn tail left by a crash (see replay); a log
+    // from an incompatible version has no valid prefix and is started afresh.
+    bool open(const string& path, FsyncPolicy fsyncPolicy, size_t recordsPerGroup,
+              uint64_t sequence, uintmax_t validLength) {
+        close();
+        error_code error;
+        if (filesystem::exists(path, error) && filesystem::file_size(path, error) > validLength) {
+            filesystem::resize_file(path, validLength, error);
+            if (error) return false;
+        }
+        file = fopen(path.c_str(), "ab");
+        if (!file) return false;
+        if (fseek(file, 0, SEEK_END) != 0 || (ftell(file) == 0 && !writeHeader())) {
+            fclose(file);
+            file = nullptr;
+            return false;
+        }
+        policy = fsyncPolicy;
+        groupSize = max<size_t>(1, recordsPerGroup);
+        lastSequence = sequence;
+        lastFsync = chrono::steady_clock::now();
+        return true;
+    }
+
+    void setFsyncInterval(chrono::milliseconds interval) { fsyncInterval = interval; }
+
+    void close() {
+        if (!file) return;
+        commit();
+        fclose(file);
+        file = nullptr;
+    }
+
+    uint64_t sequence() {
+        lock_guard<mutex> guard(lock);
+        return lastSequence;
+    }
+
+    // Queue a record; the group is committed once it reaches groupSize records
+    void append(RecordType type, const SnapshotBuffer& payload) {
+        lock_guard<mutex> guard(lock);
+        uint32_t length = (uint32_t)payload.bytes.size();
+        uint64_t recordSequence = ++lastSequence;
+        uint8_t recordType = type;
+        uint32_t sum = checksum(recordType, payload.bytes.data(), length);
+        size_t start = pending.size();
+        pending.resize(start + FRAME_HEADER + length);
+        char* frame = pending.data() + start;
+        memcpy(frame, &length, sizeof(length));
+        memcpy(frame + 4, &recordSequence, sizeof(recordSequence));
+        memcpy(frame + 12, &recordType, sizeof(recordType));
+        memcpy(frame + 13, &sum, sizeof(sum));
+        if (length) memcpy(frame + FRAME_HEADER, payload.bytes.data(), length);
+        if (++pendingRecords >= groupSize) commitLocked();
+    }
+
+    // Write the pending group; mutations are durable once this returns true.
+    // Concurrent callers share one write: whoever commits first flushes everyone's records.
+    bool commit() {
+        lock_guard<mutex> guard(lock);
+        return commitLocked();
+    }
+
+private:
+    bool commitLocked() {
+        if (!file || pending.empty()) return true;
+        bool ok = fwrite(pending.data(), 1, pending.size(), file) == pending.size() && fflush(file) == 0;
+        pending.clear();
+        pendingRecords = 0;
+        if (!ok) return false;
+        if (policy == FSYNC_EVERY_COMMIT ||
+            (policy == FSYNC_INTERVAL && chrono::steady_clock::now() - lastFsync >= fsyncInterval)) {
+            return sync();
+        }
+        return true;
+    }
+
+public:
+    // Discard the journal once a snapshot covers everything in it
+    bool reset(const string& path) {
+        lock_guard<mutex> guard(lock);
+        if (!file) return false;
+        pending.clear();
+        pendingRecords = 0;
+        file = freopen(path.c_str(), "wb", file);
+        return file && writeHeader() && sync();
+    }
+
+    // Feed every intact record with a sequence above afterSequence to apply, in order.
+    // Stops at the first torn or corrupt frame, or when apply rejects a record. Returns the last sequence seen and
+    // the length of the intact prefix of the file.
+    static uint64_t replay(const string& path, uint64_t afterSequence, uintmax_t& validLength,
+                           const function<bool(RecordType, SnapshotReader&)>& apply) {
+        validLength = 0;
+        MappedFile log;
+        if (!log.open(path)) return afterSequence;
+
+        uint64_t last = afterSequence;
+        SnapshotReader in(log.data(), log.size());
+        char magic[sizeof(MAGIC)];
+        uint32_t version = 0;
+        if (!in.getBytes(magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+            !in.get(version) || version != VERSION) {
+            return last;
+        }
+        validLength = FILE_HEADER;
+        while (true) {
+            uint32_t length = 0, sum = 0;
+            uint64_t recordSequence = 0;
+            uint8_t type = 0;
+            if (!in.get(length) || !in.get(recordSequence) || !in.get(type) || !in.get(sum)) break;
+            SnapshotReader payload(nullptr, 0);
+            const char* payloadStart = log.data() + (log.size() - in.remaining());
+            if (!in.sub(length, payload) || checksum(type, payloadStart, length) != sum) break;
+            if (recordSequence > last) {
+                if (!apply((RecordType)type, payload)) break;
+                last = recordSequence;
+            }
+            validLength = log.size() - in.remaining();
+        }
+        return last;
+    }
+};
+
+// Operation Log Class
+// Fixed-capacity ring of typed operation records. Writers claim a slot with one atomic
+// increment and never block or wait for I/O; when the ring is full the oldest record is
+// overwritten. A background thread drains new records to a text file that rotates by size,
+// and recent() copies records out without consuming them.
+class OperationLog {
+public:
+    enum OpCode : uint8_t {
+        PRODUCT_ADDED = 1,
+        PRODUCT_UPDATED,
+        PRODUCT_REMOVED,
+        PRODUCT_CATEGORIZED,
+        CATALOG_REPRICED,
+        CATALOG_IMPORTED,
+        ORDER_PLACED,
+        ORDERS_FULFILLED,
+        RULES_LOADED,
+        PROMO_CODES_IMPORTED,
+        LOW_STOCK_ALERT,
+        EXPIRY_ALERT
+    };
+
+    enum Actor : uint8_t { SYSTEM, ADMIN, CUSTOMER };
+
+    struct Record {
+        int64_t timestamp;  // Nanoseconds since the Unix epoch
+        OpCode op;
+        Actor actor;
+        int productID;      // 0 when the operation is not about one product
+        int64_t value;      // Count or order ID, depending on op
+    };
+
+private:
+    // Seqlock per slot: odd while being written, 2 * (ticket + 1) once ticket's record is complete.
+    // Fields are relaxed atomics so readers racing a writer see a stale sequence, not a torn record.
+    struct Slot {
+        atomic<uint64_t> sequence{0};
+        atomic<int64_t> timestamp{0};
+        atomic<uint64_t> packed{0};  // op | actor << 8 | productID << 32
+        atomic<int64_t> value{0};
+    };
+
+    unique_ptr<Slot[]> slots;
+    size_t mask;
+    atomic<uint64_t> head;         // Tickets handed out so far
+    atomic<uint64_t> overwritten;  // Records lost before the drain reached them
+
+    uint64_t drained;              // Drain thread only
+    FILE* file;
+    string filePath;
+    size_t fileBytes;
+    size_t maxFileBytes;
+    int keepFiles;
+
+    mutex wakeLock;
+    condition_variable wake;
+    thread drainer;
+    bool stopping;
+
+    // Copy out the record for ticket; false if it is still being written or was overwritten
+    bool read(uint64_t ticket, Record& record) const {
+        const Slot& slot = slots[ticket & mask];
+        uint64_t before = slot.sequence.load(memory_order_acquire);
+        if (before != 2 * (ticket + 1)) return false;
+        record.timestamp = slot.timestamp.load(memory_order_relaxed);
+        uint64_t packed = slot.packed.load(memory_order_relaxed);
+        record.value = slot.value.load(memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (slot.sequence.load(memory_order_relaxed) != before) return false;
+        record.op = (OpCode)(packed & 0xFF);
+        record.actor = (Actor)((packed >> 8) & 0xFF);
+        record.productID = (int)(uint32_t)(packed >> 32);
+        return true;
+    }
+
+    // Write whatever has been logged since the last drain
+    void drain() {
+        uint64_t end = head.load(memory_order_acquire);
+        if (end - drained > mask + 1) {
+            overwritten += end - drained - (mask + 1);
+            drained = end - (mask + 1);
+        }
+        for (; drained < end; drained++) {
+            Record record;
+            if (!read(drained, record)) {
+                if (slots[drained & mask].sequence.load(memory_order_acquire) < 2 * (drained + 1)) break;  // Still being written
+                overwritten++;
+                continue;
+            }
+            if (!file) continue;
+            string line = format(record);
+            line += '\n';
+            fileBytes += fwrite(line.data(), 1, line.size(), file);
+            if (fileBytes >= maxFileBytes) rotate();
+        }
+        if (file) fflush(file);
+    }
+
+    // supermarket.log -> supermarket.log.1 -> ... -> supermarket.log.<keepFiles>
+    void rotate() {
+        fclose(file);
+        error_code error;
+        for (int i = keepFiles - 1; i >= 1; i--) {
+            string from = filePath + "." + to_string(i);
+            if (filesystem::exists(from, error)) filesystem::rename(from, filePath + "." + to_string(i + 1), error);
+        }
+        if (keepFiles > 0) filesystem::rename(filePath, filePath + ".1", error);
+        file = fopen(filePath.c_str(), "wb");
+        fileBytes = 0;
+    }
+
+public:
+    // capacity is rounded up to a power of two
+    explicit OperationLog(size_t capacity = 65536)
+        : mask(0), head(0), overwritten(0), drained(0), file(nullptr), fileBytes(0),
+          maxFileBytes(4 << 20), keepFiles(3), stopping(false) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        slots.reset(new Slot[size]);
+        mask = size - 1;
+    }
+
+    ~OperationLog() { stop(); }
+
+    OperationLog(const OperationLog&) = delete;
+    OperationLog& operator=(const OperationLog&) = delete;
+
+    static const char* opName(OpCode op) {
+        switch (op) {
+            case PRODUCT_ADDED: return "PRODUCT_ADDED";
+            case PRODUCT_UPDATED: return "PRODUCT_UPDATED";
+            case PRODUCT_REMOVED: return "PRODUCT_REMOVED";
+            case PRODUCT_CATEGORIZED: return "PRODUCT_CATEGORIZED";
+            case CATALOG_REPRICED: return "CATALOG_REPRICED";
+            case CATALOG_IMPORTED: return "CATALOG_IMPORTED";
+            case ORDER_PLACED: return "ORDER_PLACED";
+            case ORDERS_FULFILLED: return "ORDERS_FULFILLED";
+            case RULES_LOADED: return "RULES_LOADED";
+            case PROMO_CODES_IMPORTED: return "PROMO_CODES_IMPORTED";
+            case LOW_STOCK_ALERT: return "LOW_STOCK_ALERT";
+            case EXPIRY_ALERT: return "EXPIRY_ALERT";
+        }
+        return "UNKNOWN";
+    }
+
+    static const char* actorName(Actor actor) {
+        static const char* const names[] = {"system", "admin", "customer"};
+        return actor <= CUSTOMER ? names[actor] : "unknown";
+    }
+
+    // One line of text: local time, actor, operation, product and value
+    static string format(const Record& record) {
+        time_t seconds = (time_t)(record.timestamp / 1000000000);
+        tm local{};
+#ifdef SMS_POSIX_IO
+        localtime_r(&seconds, &local);
+#else
+        local = *localtime(&seconds);
+#endif
+        char line[160];
+        size_t length = strftime(line, sizeof(line), "%Y-%m-%d %H:%M:%S", &local);
+        snprintf(line + length, sizeof(line) - length, ".%03d %-8s %-20s product=%d value=%lld",
+                 (int)(record.timestamp / 1000000 % 1000), actorName(record.actor), opName(record.op),
+                 record.productID, (long long)record.value);
+        return line;
+    }
+
+    // Record an operation. Lock-free; safe from any thread.
+    void log(OpCode op, Actor actor, int productID = 0, int64_t value = 0) {
+        int64_t now = chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+        uint64_t ticket = head.fetch_add(1, memory_order_relaxed);
+        Slot& slot = slots[ticket & mask];
+        slot.sequence.store(2 * ticket + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        slot.timestamp.store(now, memory_order_relaxed);
+        slot.packed.store(op | (uint64_t)actor << 8 | (uint64_t)(uint32_t)productID << 32, memory_order_relaxed);
+        slot.value.store(value, memory_order_relaxed);
+        slot.sequence.store(2 * (ticket + 1), memory_order_release);
+    }
+
+    // Append drained records to path every interval, rotating once it reaches maxBytes
+    bool start(const string& path, chrono::milliseconds interval, size_t maxBytes = 4 << 20, int rotatedFiles = 3) {
+        if (drainer.joinable()) return true;
+        file = fopen(path.c_str(), "ab");
+        if (!file) return false;
+        filePath = path;
+        fseek(file, 0, SEEK_END);
+        fileBytes = (size_t)max(0L, ftell(file));
+        maxFileBytes = max<size_t>(1, maxBytes);
+        keepFiles = max(0, rotatedFiles);
+        stopping = false;
+        drainer = thread([this, interval] {
+            unique_lock<mutex> guard(wakeLock);
+            while (!wake.wait_for(guard, interval, [this] { return stopping; })) {
+                guard.unlock();
+                drain();
+                guard.lock();
+            }
+            drain();
+        });
+        return true;
+    }
+
+    // Drain everything logged so far, then close the file
+    void stop() {
+        {
+            lock_guard<mutex> guard(wakeLock);
+            stopping = true;
+        }
+        wake.notify_all();
+        if (drainer.joinable()) drainer.join();
+        if (file) fclose(file);
+        file = nullptr;
+    }
+
+    size_t capacity() const { return mask + 1; }
+    uint64_t recorded() const { return head.load(); }
+    uint64_t lost() const { return overwritten.load(); }
+
+    // Up to limit of the most recent records still in the ring, newest first
+    vector<Record> recent(size_t limit) const {
+        vector<Record> records;
+        uint64_t end = head.load(memory_order_acquire);
+        uint64_t begin = end > mask + 1 ? end - (mask + 1) : 0;
+        for (uint64_t ticket = end; ticket > begin && records.size() < limit; ticket--) {
+            Record record;
+            if (read(ticket - 1, record)) records.push_back(record);
+        }
+        return records;
+    }
+};
+
+// Cart Item Class
+class CartItem {
+public:
+    int ID;
+    string name;
+    Money price;
+    int quantity;
+    double discount;
+
+    CartItem(int ID, string name, Money price, int quantity, double discount)
+        : ID(ID), name(name), price(price), quantity(quantity), discount(discount) {}
+};
+
 // Inventory Management Class
 class ItemNode {
 public:
     int ID;
     string name;
     string category;
-    double buyPrice;
-    double sellPrice;
+    Money buyPrice;
+    Money sellPrice;
+    Money listPrice;  // Sell price before dynamic pricing
     int quantity;
-    int expire;
+    int64_t expiryDay;  // Days since the Unix epoch
     string supplierName;
     int discount;
     int demand;
     ItemNode* next;
-    ItemNode* left;
-    ItemNode* right;
+    ItemNode* prev;
+    size_t row;  // Position in InventoryColumns
 
     // Constructor
-    ItemNode(int ID, int quantity, int expire, int discount, double sellPrice, double buyPrice, string name, string category, string supplierName, int demand) {
+    ItemNode(int ID, int quantity, int64_t expiryDay, int discount, Money sellPrice, Money buyPrice, string name, string category, string supplierName, int demand) {
         this->ID = ID;
-        this->name = name;
-        this->category = category;
+        this->name = std::move(name);
+        this->category = std::move(category);
         this->buyPrice = buyPrice;
         this->sellPrice = sellPrice;
+        this->listPrice = sellPrice;
         this->quantity = quantity;
-        this->expire = expire;
-        this->supplierName = supplierName;
+        this->expiryDay = expiryDay;
+        this->supplierName = std::move(supplierName);
         this->discount = discount;
         this->demand = demand;
         this->next = nullptr;
-        this->left = nullptr;
-        this->right = nullptr;
+        this->prev = nullptr;
+        this->row = 0;
+    }
+};
+
+// Product Index Class
+// Open-addressing hash table (linear probing) mapping product ID -> ItemNode*
+class ProductIndex {
+private:
+    vector<int> keys;
+    vector<ItemNode*> values;  // nullptr marks an empty slot
+    size_t count;
+
+    static size_t hashID(int ID) {
+        // Fibonacci hashing spreads sequential IDs across the table
+        return (size_t)((uint64_t)(uint32_t)ID * 11400714819323198485ull >> 16);
+    }
+
+    size_t slotFor(int ID) const {
+        size_t mask = keys.size() - 1;
+        size_t slot = hashID(ID) & mask;
+        while (values[slot] && keys[slot] != ID) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    void grow() {
+        vector<int> oldKeys;
+        vector<ItemNode*> oldValues;
+        oldKeys.swap(keys);
+        oldValues.swap(values);
+        keys.assign(oldKeys.size() * 2, 0);
+        values.assign(oldValues.size() * 2, nullptr);
+        for (size_t i = 0; i < oldValues.size(); i++) {
+            if (oldValues[i]) {
+                size_t slot = slotFor(oldKeys[i]);
+                keys[slot] = oldKeys[i];
+                values[slot] = oldValues[i];
+            }
+        }
+    }
+
+public:
+    ProductIndex() : keys(16, 0), values(16, nullptr), count(0) {}
+
+    size_t size() const { return count; }
+
+    // Grow ahead of a bulk load so it never rehashes
+    void reserve(size_t total) {
+        while (total * 4 > keys.size() * 3) grow();
+    }
+
+    ItemNode* find(int ID) const {
+        return values[slotFor(ID)];
+    }
+
+    // Returns false if the ID is already indexed
+    bool insert(int ID, ItemNode* item) {
+        if ((count + 1) * 4 > keys.size() * 3) {  // keep load factor below 0.75
+            grow();
+        }
+        size_t slot = slotFor(ID);
+        if (values[slot]) return false;
+        keys[slot] = ID;
+        values[slot] = item;
+        count++;
+        return true;
+    }
+
+    // Backward-shift deletion keeps probe chains intact without tombstones
+    bool erase(int ID) {
+        size_t mask = keys.size() - 1;
+        size_t hole = slotFor(ID);
+        if (!values[hole]) return false;
+        values[hole] = nullptr;
+        count--;
+        size_t next = (hole + 1) & mask;
+        while (values[next]) {
+            size_t home = hashID(keys[next]) & mask;
+            // Move the entry back if its home slot is not in (hole, next]
+            if (((next - home) & mask) >= ((next - hole) & mask)) {
+                keys[hole] = keys[next];
+                values[hole] = values[next];
+                values[next] = nullptr;
+                hole = next;
+            }
+            next = (next + 1) & mask;
+        }
+        return true;
+    }
+};
+
+// Product Tree Class
+// AVL tree ordered by product ID; nodes point at the canonical ItemNode records
+class ProductTree {
+private:
+    struct TreeNode {
+        ItemNode* item;
+        TreeNode* left;
+        TreeNode* right;
+        int height;
+
+        TreeNode(ItemNode* item) : item(item), left(nullptr), right(nullptr), height(1) {}
+    };
+
+    TreeNode* root;
+    size_t count;
+    ObjectPool<TreeNode> nodePool;
+
+    static int height(TreeNode* node) { return node ? node->height : 0; }
+
+    static void updateHeight(TreeNode* node) {
+        node->height = 1 + max(height(node->left), height(node->right));
+    }
+
+    static TreeNode* rotateRight(TreeNode* node) {
+        TreeNode* pivot = node->left;
+        node->left = pivot->right;
+        pivot->right = node;
+        updateHeight(node);
+        updateHeight(pivot);
+        return pivot;
+    }
+
+    static TreeNode* rotateLeft(TreeNode* node) {
+        TreeNode* pivot = node->right;
+        node->right = pivot->left;
+        pivot->left = node;
+        updateHeight(node);
+        updateHeight(pivot);
+        return pivot;
+    }
+
+    static TreeNode* rebalance(TreeNode* node) {
+        updateHeight(node);
+        int balance = height(node->left) - height(node->right);
+        if (balance > 1) {
+            if (height(node->left->left) < height(node->left->right)) {
+                node->left = rotateLeft(node->left);
+            }
+            return rotateRight(node);
+        }
+        if (balance < -1) {
+            if (height(node->right->right) < height(node->right->left)) {
+                node->right = rotateRight(node->right);
+            }
+            return rotateLeft(node);
+        }
+        return node;
+    }
+
+    TreeNode* insert(TreeNode* node, ItemNode* item, bool& inserted) {
+        if (!node) {
+            inserted = true;
+            count++;
+            return nodePool.create(item);
+        }
+        if (item->ID < node->item->ID) {
+            node->left = insert(node->left, item, inserted);
+        } else if (item->ID > node->item->ID) {
+            node->right = insert(node->right, item, inserted);
+        } else {
+            return node;  // already in the tree
+        }
+        return rebalance(node);
+    }
+
+    static TreeNode* detachMin(TreeNode* node, TreeNode*& minNode) {
+        if (!node->left) {
+            minNode = node;
+            return node->right;
+        }
+        node->left = detachMin(node->left, minNode);
+        return rebalance(node);
+    }
+
+    TreeNode* erase(TreeNode* node, int ID, bool& erased) {
+        if (!node) return nullptr;
+        if (ID < node->item->ID) {
+            node->left = erase(node->left, ID, erased);
+        } else if (ID > node->item->ID) {
+            node->right = erase(node->right, ID, erased);
+        } else {
+            erased = true;
+            count--;
+            if (!node->left || !node->right) {
+                TreeNode* child = node->left ? node->left : node->right;
+                nodePool.destroy(node);
+                return child;
+            }
+            // Replace the node with its in-order successor
+            TreeNode* successor = nullptr;
+            TreeNode* right = detachMin(node->right, successor);
+            successor->left = node->left;
+            successor->right = right;
+            nodePool.destroy(node);
+            return rebalance(successor);
+        }
+        return rebalance(node);
+    }
+
+    // Height of a subtree whose IDs must lie strictly between low and high, or -1 if the
+    // ordering, a stored height or the AVL balance is wrong anywhere in it
+    static int checkedHeight(const TreeNode* node, int64_t low, int64_t high) {
+        if (!node) return 0;
+        if (node->item->ID <= low || node->item->ID >= high) return -1;
+        int left = checkedHeight(node->left, low, node->item->ID);
+        int right = checkedHeight(node->right, node->item->ID, high);
+        if (left < 0 || right < 0 || abs(left - right) > 1 || node->height != 1 + max(left, right)) return -1;
+        return node->height;
+    }
+
+    template <typename Visitor>
+    static void rangeScan(TreeNode* node, int low, int high, Visitor& visit) {
+        if (!node) return;
+        if (low < node->item->ID) rangeScan(node->left, low, high, visit);
+        if (low <= node->item->ID && node->item->ID <= high) visit(node->item);
+        if (node->item->ID < high) rangeScan(node->right, low, high, visit);
+    }
+
+public:
+    // Tree nodes are trivially destructible; the pool releases their memory
+    ProductTree() : root(nullptr), count(0) {}
+
+    ProductTree(const ProductTree&) = delete;
+    ProductTree& operator=(const ProductTree&) = delete;
+
+    bool empty() const { return root == nullptr; }
+    size_t size() const { return count; }
+
+    // Returns false if a product with the same ID is already in the tree
+    bool insert(ItemNode* item) {
+        bool inserted = false;
+        root = insert(root, item, inserted);
+        return inserted;
+    }
+
+    bool erase(int ID) {
+        bool erased = false;
+        root = erase(root, ID, erased);
+        return erased;
+    }
+
+    ItemNode* find(int ID) const {
+        TreeNode* node = root;
+        while (node) {
+            if (ID < node->item->ID) {
+                node = node->left;
+            } else if (ID > node->item->ID) {
+                node = node->right;
+            } else {
+                return node->item;
+            }
+        }
+        return nullptr;
+    }
+
+    // Visit every product with low <= ID <= high in ascending ID order
+    template <typename Visitor>
+    void forEachInRange(int low, int high, Visitor visit) const {
+        rangeScan(root, low, high, visit);
+    }
+
+    // Ordering, stored heights and AVL balance hold at every node (see --check)
+    bool balanced() const {
+        return checkedHeight(root, INT64_MIN, INT64_MAX) >= 0;
+    }
+};
+
+// Ranked Prefix Index Class
+// Keys kept in sorted runs, so every prefix is a contiguous range of slots in each run, with
+// a tournament tree over each run to pull products out of any set of ranges by demand.
+// Keys are views; the owner keeps their text alive until a rebuild that started after the
+// key was removed has finished (see buildsStarted/buildsFinished).
+// New keys wait in a short unsorted list, then are merged into a small delta run; the
+// delta is folded into the large base run a bounded step per update, so no single update
+// or query pays for a whole rebuild.
+class RankedPrefixIndex {
+public:
+    struct Entry {
+        string_view key;
+        uint64_t head;   // First 8 bytes of key, big-endian and zero padded, so most
+                         // comparisons never leave the entry
+        int ID;
+        int demand;      // item->demand, so ranking never leaves the entry either
+        ItemNode* item;  // nullptr once removed
+    };
+
+    struct Range {
+        size_t lo, hi;  // Slots [lo, hi)
+    };
+
+    // The sorted keys in [lo, hi), which share their first depth characters, seen as a
+    // trie node. trieNode is its materialized node, if it has one.
+    struct Node {
+        size_t lo, hi, depth;
+        uint32_t trieNode;
+    };
+
+private:
+    static constexpr size_t PENDING_LIMIT = 1024;  // Unsorted keys tolerated before a merge into the delta
+    static constexpr size_t REBUILD_RATIO = 16;    // Rebuild once delta keys and tombstones reach base / REBUILD_RATIO
+    static constexpr size_t STEP_SPEED = 16;       // Finish within 1/STEP_SPEED of the updates that start the next one
+    static constexpr size_t MIN_STEP_WORK = 4096;  // Rebuild work per update on small indexes
+    static constexpr size_t TRIE_DEPTH = 4;        // Levels kept as explicit trie nodes
+    static constexpr uint32_t NO_TRIE_NODE = UINT32_MAX;
+
+    struct TrieNode {
+        uint32_t lo, body, hi;  // Keys [lo, hi); those in [lo, body) end at this depth
+        uint32_t firstChild;    // Children are contiguous in trie
+        uint32_t childCount;
+        unsigned char c;        // Last character of the node's prefix
+        unsigned char depth;
+    };
+
+    static uint64_t packHead(string_view key) {
+        uint64_t head = 0;
+        for (size_t i = 0; i < 8; i++) head = (head << 8) | (i < key.size() ? (unsigned char)key[i] : 0);
+        return head;
+    }
+
+    static Entry makeEntry(string_view key, int ID, ItemNode* item) {
+        return {key, packHead(key), ID, item ? item->demand : 0, item};
+    }
+
+    static bool keyOrder(const Entry& a, const Entry& b) {
+        if (a.head != b.head) return a.head < b.head;
+        int order = a.key.compare(b.key);
+        return order != 0 ? order < 0 : a.ID < b.ID;
+    }
+
+public:
+    // Higher demand first, then lower ID
+    static bool ranksBefore(const ItemNode* a, const ItemNode* b) {
+        if (a->demand != b->demand) return a->demand > b->demand;
+        return a->ID < b->ID;
+    }
+
+    static bool ranksBefore(const Entry& a, const Entry& b) {
+        if (a.demand != b.demand) return a.demand > b.demand;
+        return a.ID < b.ID;
+    }
+
+    // One sorted run of keys with its tournament tree and the top levels of its trie
+    class Run {
+    private:
+        friend class RankedPrefixIndex;
+
+        vector<Entry> sorted;   // By key, then ID
+        vector<TrieNode> trie;  // The top TRIE_DEPTH levels of sorted; node 0 is the root
+        vector<int32_t> tree;   // Best live slot under each node, or -1; leaves start at leafBase
+        size_t leafBase;
+        size_t removed;         // Tombstones in sorted
+
+        int32_t better(int32_t a, int32_t b) const {
+            if (a < 0) return b;
+            if (b < 0) return a;
+            return ranksBefore(sorted[a], sorted[b]) ? a : b;
+        }
+
+        // While a run is being built its tree grows leaves first, then inner nodes;
+        // a leaf not built yet reads its entry when it is
+        void updateLeaf(size_t slot) {
+            size_t node = leafBase + slot;
+            if (node >= tree.size()) return;
+            tree[node] = sorted[slot].item ? (int32_t)slot : -1;
+            if (tree.size() < 2 * leafBase) return;
+            for (node /= 2; node; node /= 2) tree[node] = better(tree[2 * node], tree[2 * node + 1]);
+        }
+
+        // Slot of the live entry for (key, ID), or sorted.size()
+        size_t findSorted(string_view key, int ID) const {
+            Entry probe = makeEntry(key, ID, nullptr);
+            for (auto it = lower_bound(sorted.begin(), sorted.end(), probe, keyOrder);
+                 it != sorted.end() && it->ID == ID && it->key == key; ++it) {
+                if (it->item) return (size_t)(it - sorted.begin());
+            }
+            return sorted.size();
+        }
+
+        bool remove(string_view key, int ID) {
+            size_t slot = findSorted(key, ID);
+            if (slot == sorted.size()) return false;
+            sorted[slot].item = nullptr;
+            updateLeaf(slot);
+            removed++;
+            return true;
+        }
+
+        void demandChanged(string_view key, int ID) {
+            size_t slot = findSorted(key, ID);
+            if (slot == sorted.size()) return;
+            sorted[slot].demand = sorted[slot].item->demand;
+            updateLeaf(slot);
+        }
+
+        // End of the child that starts at slot lo, among keys [lo, hi) sharing depth characters
+        size_t childEnd(size_t lo, size_t hi, size_t depth) const {
+            unsigned char c = charAt(lo, depth);
+            auto inChild = [&](size_t slot) { return charAt(slot, depth) == c; };
+            size_t low = lo + 1, high = lo + 1, step = 1;
+            while (high < hi && inChild(high)) {
+                low = high + 1;
+                high = min(hi, high + step);
+                step *= 2;
+            }
+            while (low < high) {
+                size_t mid = (low + high) / 2;
+                if (inChild(mid)) {
+                    low = mid + 1;
+                } else {
+                    high = mid;
+                }
+            }
+            return low;
+        }
+
+        // Materialize the children of trie node index; returns the work done
+        size_t expandTrie(uint32_t index) {
+            TrieNode node = trie[index];
+            auto first = sorted.begin() + node.lo;
+            uint32_t body = node.lo + (uint32_t)(partition_point(first, sorted.begin() + node.hi, [&](const Entry& entry) {
+                return entry.key.size() == node.depth;
+            }) - first);
+            trie[index].body = body;
+            if (node.depth == TRIE_DEPTH) return 1;
+            uint32_t firstChild = (uint32_t)trie.size();
+            for (size_t lo = body; lo < node.hi;) {
+                size_t end = childEnd(lo, node.hi, node.depth);
+                trie.push_back({(uint32_t)lo, (uint32_t)lo, (uint32_t)end, 0, 0, charAt(lo, node.depth),
+                                (unsigned char)(node.depth + 1)});
+                lo = end;
+            }
+            trie[index].firstChild = firstChild;
+            trie[index].childCount = (uint32_t)trie.size() - firstChild;
+            return 1 + 16 * trie[index].childCount;
+        }
+
+    public:
+        Run() : tree(2, -1), leafBase(1), removed(0) {}
+
+        size_t size() const { return sorted.size(); }
+        const Entry& at(size_t slot) const { return sorted[slot]; }
+
+        // Character depth of the key in slot
+        unsigned char charAt(size_t slot, size_t depth) const {
+            const Entry& entry = sorted[slot];
+            return depth < 8 ? (unsigned char)(entry.head >> (56 - 8 * depth)) : (unsigned char)entry.key[depth];
+        }
+
+        Node root() const {
+            return {0, sorted.size(), 0, trie.empty() ? NO_TRIE_NODE : 0};
+        }
+
+        // Slots of the node's keys that end at its depth; they sort ahead of the longer ones
+        Range ended(const Node& node) const {
+            if (node.trieNode != NO_TRIE_NODE) return {node.lo, trie[node.trieNode].body};
+            size_t end = node.lo;
+            while (end < node.hi && sorted[end].key.size() == node.depth) end++;
+            return {node.lo, end};
+        }
+
+        // Visit each child node with the character it adds, in order: visit(c, child).
+        // Below the materialized levels, children are found by galloping search.
+        template <typename Visitor>
+        void forEachChild(const Node& node, Visitor visit) const {
+            if (node.trieNode != NO_TRIE_NODE && node.depth < TRIE_DEPTH) {
+                const TrieNode& parent = trie[node.trieNode];
+                for (uint32_t index = parent.firstChild; index < parent.firstChild + parent.childCount; index++) {
+                    const TrieNode& child = trie[index];
+                    visit(child.c, Node{child.lo, child.hi, node.depth + 1, index});
+                }
+                return;
+            }
+            for (size_t lo = ended(node).hi; lo < node.hi;) {
+                size_t end = childEnd(lo, node.hi, node.depth);
+                visit(charAt(lo, node.depth), Node{lo, end, node.depth + 1, NO_TRIE_NODE});
+                lo = end;
+            }
+        }
+
+        // Slots whose key starts with the prefix
+        Range prefixRange(string_view prefix) const {
+            Entry probe = makeEntry(prefix, INT_MIN, nullptr);
+            auto first = lower_bound(sorted.begin(), sorted.end(), probe, keyOrder);
+            auto last = partition_point(first, sorted.end(), [&](const Entry& entry) {
+                return entry.key.compare(0, prefix.size(), prefix) == 0;
+            });
+            return {(size_t)(first - sorted.begin()), (size_t)(last - sorted.begin())};
+        }
+
+        // Visit the live products in the ranges best first until visit returns false:
+        // O(log n) per product visited, however large the ranges
+        template <typename Visitor>
+        void visitBest(const vector<Range>& ranges, Visitor visit) const {
+            auto worse = [this](size_t a, size_t b) { return ranksBefore(sorted[tree[b]], sorted[tree[a]]); };
+            vector<size_t> frontier;
+            auto push = [&](size_t node) {
+                if (tree[node] < 0) return;
+                frontier.push_back(node);
+                push_heap(frontier.begin(), frontier.end(), worse);
+            };
+            for (const Range& range : ranges) {
+                for (size_t lo = range.lo + leafBase, hi = range.hi + leafBase; lo < hi; lo /= 2, hi /= 2) {
+                    if (lo & 1) push(lo++);
+                    if (hi & 1) push(--hi);
+                }
+            }
+            while (!frontier.empty()) {
+                pop_heap(frontier.begin(), frontier.end(), worse);
+                size_t node = frontier.back();
+                frontier.pop_back();
+                if (node >= leafBase) {
+                    if (!visit(sorted[tree[node]].item)) return;
+                } else {
+                    push(2 * node);
+                    push(2 * node + 1);
+                }
+            }
+        }
+    };
+
+private:
+    // Merges the live entries of two sorted lists into a new run, then builds its tree and
+    // trie, a bounded amount of work per step. Every step must be given the same lists,
+    // unchanged except that their entries may be removed.
+    class RunBuilder {
+    private:
+        enum Phase { MERGE, TREE, TRIE, DONE };
+
+        size_t leftPos, rightPos;
+        size_t cursor;  // Next tree node (filled upwards from the leaves) or trie node to expand
+        Phase phase;
+
+    public:
+        Run out;
+
+        RunBuilder() : leftPos(0), rightPos(0), cursor(0), phase(DONE) {}
+
+        bool active() const { return phase != DONE; }
+
+        void start(const vector<Entry>& left, const vector<Entry>& right) {
+            leftPos = rightPos = 0;
+            phase = MERGE;
+            out = Run();
+            out.tree.clear();
+            out.sorted.reserve(left.size() + right.size());
+        }
+
+        // Do about budget units of work; returns true once out is complete
+        bool step(const vector<Entry>& left, const vector<Entry>& right, size_t budget) {
+            while (budget && phase != DONE) {
+                if (phase == MERGE) {
+                    for (; budget && (leftPos < left.size() || rightPos < right.size()); budget--) {
+                        bool fromLeft = rightPos == right.size() ||
+                                        (leftPos < left.size() && keyOrder(left[leftPos], right[rightPos]));
+                        const Entry& entry = fromLeft ? left[leftPos++] : right[rightPos++];
+                        if (entry.item) out.sorted.push_back(entry);
+                    }
+                    if (leftPos < left.size() || rightPos < right.size()) break;
+                    out.leafBase = 1;
+                    while (out.leafBase < out.sorted.size()) out.leafBase *= 2;
+                    out.tree.reserve(2 * out.leafBase);
+                    phase = TREE;
+                } else if (phase == TREE) {
+                    // Inner nodes start at -1 and the leaves are filled in; then the inner
+                    // nodes are computed from the bottom up
+                    for (; budget && out.tree.size() < 2 * out.leafBase; budget--) {
+                        size_t slot = out.tree.size() - min(out.tree.size(), out.leafBase);
+                        bool leaf = out.tree.size() >= out.leafBase && slot < out.sorted.size();
+                        out.tree.push_back(leaf && out.sorted[slot].item ? (int32_t)slot : -1);
+                        if (out.tree.size() == 2 * out.leafBase) cursor = out.leafBase - 1;
+                    }
+                    for (; budget && cursor && out.tree.size() == 2 * out.leafBase; cursor--, budget--) {
+                        out.tree[cursor] = out.better(out.tree[2 * cursor], out.tree[2 * cursor + 1]);
+                    }
+                    if (out.tree.size() < 2 * out.leafBase || cursor) break;
+                    out.trie.assign(1, {0, 0, (uint32_t)out.sorted.size(), 0, 0, 0, 0});
+                    phase = TRIE;
+                } else {
+                    for (; budget && cursor < out.trie.size(); cursor++) budget -= min(budget, out.expandTrie((uint32_t)cursor));
+                    if (cursor == out.trie.size()) phase = DONE;
+                }
+            }
+            return phase == DONE;
+        }
+    };
+
+    Run base;             // Most keys
+    Run frozen;           // A former delta being merged into the base
+    Run delta;            // Keys merged from pending since the last rebuild started
+    RunBuilder rebuilder; // Merges base and frozen into the next base
+    size_t stepWork;      // Rebuild work done per update
+    vector<Entry> pending;  // Added since the last merge into the delta, scanned linearly
+    uint64_t startedBuilds, finishedBuilds;
+
+    // Sort the pending keys into the delta, dropping both lists' tombstones: O(delta)
+    void mergePending() {
+        vector<Entry> batch;
+        batch.reserve(pending.size());
+        for (Entry& entry : pending) {
+            if (!entry.item) continue;
+            entry.demand = entry.item->demand;  // Pending entries are not re-ranked as demand changes
+            batch.push_back(entry);
+        }
+        pending.clear();
+        sort(batch.begin(), batch.end(), keyOrder);
+        RunBuilder merge;
+        merge.start(delta.sorted, batch);
+        merge.step(delta.sorted, batch, SIZE_MAX);
+        delta = std::move(merge.out);
+    }
+
+    void startRebuild() {
+        frozen = std::move(delta);
+        delta = Run();
+        rebuilder.start(base.sorted, frozen.sorted);
+        startedBuilds++;
+        // About four units of work per key: merge, leaf, inner node and trie
+        size_t work = 4 * (base.size() + frozen.size());
+        stepWork = max(MIN_STEP_WORK, work * STEP_SPEED / rebuildThreshold());
+    }
+
+    void finishRebuild() {
+        base = std::move(rebuilder.out);
+        frozen = Run();
+        finishedBuilds++;
+    }
+
+    size_t rebuildThreshold() const {
+        return max(PENDING_LIMIT, base.size() / REBUILD_RATIO);
+    }
+
+public:
+    RankedPrefixIndex() : stepWork(MIN_STEP_WORK), startedBuilds(0), finishedBuilds(0) {}
+
+    void add(string_view key, ItemNode* item) {
+        pending.push_back(makeEntry(key, item->ID, item));
+    }
+
+    void remove(string_view key, int ID) {
+        if (rebuilder.active()) rebuilder.out.remove(key, ID);
+        if (base.remove(key, ID) || frozen.remove(key, ID) || delta.remove(key, ID)) return;
+        for (Entry& entry : pending) {
+            if (entry.item && entry.ID == ID && entry.key == key) {
+                entry.item = nullptr;
+                return;
+            }
+        }
+    }
+
+    // Re-rank a product after its demand changed
+    void demandChanged(string_view key, int ID) {
+        base.demandChanged(key, ID);
+        frozen.demandChanged(key, ID);
+        delta.demandChanged(key, ID);
+        if (rebuilder.active()) rebuilder.out.demandChanged(key, ID);
+    }
+
+    // Call after each batch of add/remove calls: merges a full pending list into the delta
+    // and advances the rebuild of the base by one bounded step
+    void maintain() {
+        if (pending.size() >= PENDING_LIMIT) mergePending();
+        if (!rebuilder.active() && delta.size() + base.removed >= rebuildThreshold()) startRebuild();
+        if (rebuilder.active() && rebuilder.step(base.sorted, frozen.sorted, stepWork)) finishRebuild();
+    }
+
+    // Fold everything into the base now: O(n log n), for bulk loads
+    void compact() {
+        if (rebuilder.active() && rebuilder.step(base.sorted, frozen.sorted, SIZE_MAX)) finishRebuild();
+        if (!pending.empty()) mergePending();
+        if (!base.size() && !delta.removed) {  // Nothing to merge with or drop: the delta becomes the base
+            startedBuilds++;
+            swap(base, delta);
+            finishedBuilds++;
+        } else if (delta.size() || base.removed) {
+            startRebuild();
+            rebuilder.step(base.sorted, frozen.sorted, SIZE_MAX);
+            finishRebuild();
+        }
+    }
+
+    // Rebuilds started and finished so far; one is in progress while they differ
+    uint64_t buildsStarted() const { return startedBuilds; }
+    uint64_t buildsFinished() const { return finishedBuilds; }
+
+    // Visit the sorted runs that answer queries
+    template <typename Visitor>
+    void forEachRun(Visitor visit) const {
+        visit(base);
+        if (frozen.size()) visit(frozen);
+        if (delta.size()) visit(delta);
+    }
+
+    // Live keys not yet in sorted order
+    template <typename Visitor>
+    void forEachPending(Visitor visit) const {
+        for (const Entry& entry : pending) {
+            if (entry.item) visit(entry);
+        }
+    }
+};
+
+// Product Search Engine Class
+// Type-ahead search over product names: prefix queries over whole names, and typo-tolerant
+// queries over the start of every word, both answered from ranked prefix indexes
+class ProductSearchEngine {
+private:
+    typedef unordered_map<int, pair<string, ItemNode*>> KeyMap;
+
+    // Name of a removed product, viewed by tombstones until a rebuild of each index that
+    // started after the removal has finished
+    struct RetiredName {
+        KeyMap::node_type name;
+        uint64_t namesBuild, wordsBuild;
+    };
+
+    KeyMap indexed;                      // ID -> (lowercase name, product); the indexes view these names
+    deque<RetiredName> retired;          // In removal order
+    RankedPrefixIndex names;             // Whole names
+    RankedPrefixIndex words;             // Name suffixes starting at each word
+
+    static string normalize(const string& text) {
+        string key = text;
+        for (char& c : key) c = (char)tolower((unsigned char)c);
+        return key;
+    }
+
+    // Offsets of the words in a name
+    static vector<size_t> wordStarts(const string& key) {
+        vector<size_t> starts;
+        for (size_t i = 0; i < key.size(); i++) {
+            if (key[i] != ' ' && (i == 0 || key[i - 1] == ' ')) starts.push_back(i);
+        }
+        return starts;
+    }
+
+    // Extend the edit-distance row of the query against some text by one character
+    static void nextRow(const string& query, const int* row, unsigned char c, int* next) {
+        next[0] = row[0] + 1;
+        for (size_t i = 1; i <= query.size(); i++) {
+            int cost = (unsigned char)query[i - 1] == c ? 0 : 1;
+            next[i] = min({row[i] + 1, next[i - 1] + 1, row[i - 1] + cost});
+        }
+    }
+
+    // Smallest edit distance between the query and any prefix of the text; stops once
+    // no longer prefix can come within maxEdits
+    static int prefixEditDistance(const string& query, string_view text, int maxEdits) {
+        vector<int> row(query.size() + 1), next(query.size() + 1);
+        for (size_t i = 0; i <= query.size(); i++) row[i] = (int)i;
+        int distance = row[query.size()];
+        for (unsigned char c : text) {
+            nextRow(query, row.data(), c, next.data());
+            row.swap(next);
+            distance = min(distance, row[query.size()]);
+            if (*min_element(row.begin(), row.end()) > min(maxEdits, distance - 1)) break;
+        }
+        return distance;
+    }
+
+    struct FuzzyRange {
+        RankedPrefixIndex::Range slots;
+        int distance;
+    };
+
+    // Walk a run of the word index as a trie. rows holds one edit-distance row of the query
+    // per depth; distance is the best prefix distance seen on the way down. Subtrees whose
+    // distance can no longer improve are emitted whole; subtrees that can never come
+    // within maxEdits are skipped.
+    static void fuzzyWalk(const RankedPrefixIndex::Run& run, const string& query, int maxEdits,
+                          const RankedPrefixIndex::Node& node, int distance, vector<int>& rows, vector<FuzzyRange>& matches) {
+        size_t width = query.size() + 1, depth = node.depth;
+        int rowMin = *min_element(rows.begin() + depth * width, rows.begin() + (depth + 1) * width);
+        if (distance <= rowMin || rowMin > maxEdits) {
+            if (distance <= maxEdits) matches.push_back({{node.lo, node.hi}, distance});
+            return;
+        }
+        RankedPrefixIndex::Range ended = run.ended(node);
+        if (ended.lo < ended.hi && distance <= maxEdits) matches.push_back({ended, distance});
+
+        if (rows.size() < (depth + 2) * width) rows.resize((depth + 2) * width);
+        run.forEachChild(node, [&](unsigned char c, const RankedPrefixIndex::Node& child) {
+            nextRow(query, &rows[depth * width], c, &rows[(depth + 1) * width]);
+            fuzzyWalk(run, query, maxEdits, child, min(distance, rows[(depth + 1) * width + query.size()]), rows, matches);
+        });
+    }
+
+    void insertKeys(ItemNode* item) {
+        auto& entry = indexed[item->ID];
+        entry = {normalize(item->name), item};
+        string_view key = entry.first;
+        names.add(key, item);
+        for (size_t start : wordStarts(entry.first)) words.add(key.substr(start), item);
+    }
+
+    // Let both indexes take their bounded step, then free the names no tombstone views
+    void maintain() {
+        names.maintain();
+        words.maintain();
+        while (!retired.empty() && names.buildsFinished() > retired.front().namesBuild &&
+               words.buildsFinished() > retired.front().wordsBuild) {
+            retired.pop_front();
+        }
+    }
+
+    // Keep the k best products seen so far; ranked by lower rank first, then higher demand
+    static void offer(vector<pair<int, ItemNode*>>& best, size_t k, int rank, ItemNode* item) {
+        auto worse = [](const pair<int, ItemNode*>& a, const pair<int, ItemNode*>& b) {
+            if (a.first != b.first) return a.first < b.first;
+            return RankedPrefixIndex::ranksBefore(a.second, b.second);
+        };
+        if (best.size() < k) {
+            best.push_back({rank, item});
+            push_heap(best.begin(), best.end(), worse);
+        } else if (worse({rank, item}, best.front())) {
+            pop_heap(best.begin(), best.end(), worse);
+            best.back() = {rank, item};
+            push_heap(best.begin(), best.end(), worse);
+        }
+    }
+
+    static vector<ItemNode*> ranked(vector<pair<int, ItemNode*>>& best) {
+        sort(best.begin(), best.end(), [](const pair<int, ItemNode*>& a, const pair<int, ItemNode*>& b) {
+            if (a.first != b.first) return a.first < b.first;
+            return RankedPrefixIndex::ranksBefore(a.second, b.second);
+        });
+        vector<ItemNode*> results;
+        for (const auto& entry : best) results.push_back(entry.second);
+        return results;
+    }
+
+public:
+    void addProduct(ItemNode* item) {
+        insertKeys(item);
+        maintain();
+    }
+
+    // Bulk loads add every product with loadProduct, then call compact once
+    void loadProduct(ItemNode* item) {
+        insertKeys(item);
+    }
+
+    void compact() {
+        names.compact();
+        words.compact();
+        maintain();
+    }
+
+    void removeProduct(int ID) {
+        auto entry = indexed.find(ID);
+        if (entry == indexed.end()) return;
+        string_view key = entry->second.first;
+        names.remove(key, ID);
+        for (size_t start : wordStarts(entry->second.first)) words.remove(key.substr(start), ID);
+        retired.push_back({indexed.extract(entry), names.buildsStarted(), words.buildsStarted()});
+        maintain();
+    }
+
+    // Re-rank a product after its demand changed
+    void demandChanged(int ID) {
+        auto entry = indexed.find(ID);
+        if (entry == indexed.end()) return;
+        string_view key = entry->second.first;
+        names.demandChanged(key, ID);
+        for (size_t start : wordStarts(entry->second.first)) words.demandChanged(key.substr(start), ID);
+    }
+
+    // Top-k products whose name starts with the prefix, highest demand first
+    vector<ItemNode*> prefixSearch(const string& prefix, size_t k) const {
+        if (!k) return {};
+        string key = normalize(prefix);
+        vector<pair<int, ItemNode*>> best;
+        names.forEachRun([&](const RankedPrefixIndex::Run& run) {
+            size_t taken = 0;
+            run.visitBest({run.prefixRange(key)}, [&](ItemNode* item) {
+                offer(best, k, 0, item);
+                return ++taken < k;
+            });
+        });
+        names.forEachPending([&](const RankedPrefixIndex::Entry& entry) {
+            if (entry.key.compare(0, key.size(), key) == 0) offer(best, k, 0, entry.item);
+        });
+        return ranked(best);
+    }
+
+    // Top-k products with a word that starts with something within maxEdits of the query,
+    // closest match first and then by demand
+    vector<ItemNode*> fuzzySearch(const string& query, size_t k, int maxEdits = 2) const {
+        string key = normalize(query);
+        if (!k || key.empty()) return {};
+
+        vector<pair<const RankedPrefixIndex::Run*, vector<FuzzyRange>>> runMatches;
+        words.forEachRun([&](const RankedPrefixIndex::Run& run) {
+            vector<int> rows(key.size() + 1);
+            for (size_t i = 0; i <= key.size(); i++) rows[i] = (int)i;
+            runMatches.push_back({&run, {}});
+            fuzzyWalk(run, key, maxEdits, run.root(), (int)key.size(), rows, runMatches.back().second);
+        });
+
+        // A product can match through several words; its closest one counts
+        vector<pair<int, ItemNode*>> best;
+        unordered_set<int> seen;
+        for (int distance = 0; distance <= maxEdits && best.size() < k; distance++) {
+            for (const auto& run : runMatches) {
+                vector<RankedPrefixIndex::Range> ranges;
+                for (const FuzzyRange& match : run.second) {
+                    if (match.distance == distance) ranges.push_back(match.slots);
+                }
+                size_t taken = 0;
+                run.first->visitBest(ranges, [&](ItemNode* item) {
+                    if (seen.insert(item->ID).second) {
+                        offer(best, k, distance, item);
+                        taken++;
+                    }
+                    return taken < k;
+                });
+            }
+        }
+        unordered_map<int, int> pendingDistance;
+        words.forEachPending([&](const RankedPrefixIndex::Entry& entry) {
+            if (seen.count(entry.ID)) return;
+            int distance = prefixEditDistance(key, entry.key, maxEdits);
+            if (distance > maxEdits) return;
+            auto known = pendingDistance.emplace(entry.ID, distance);
+            if (!known.second) known.first->second = min(known.first->second, distance);
+        });
+        for (const auto& entry : pendingDistance) offer(best, k, entry.second, indexed.at(entry.first).second);
+        return ranked(best);
+    }
+};
+
+// String Pool Class
+// Interns repeated strings (categories, suppliers) as small integer IDs
+class StringPool {
+private:
+    vector<string> strings;
+    unordered_map<string, uint32_t> ids;
+
+public:
+    uint32_t intern(const string& text) {
+        auto entry = ids.find(text);
+        if (entry != ids.end()) return entry->second;
+        uint32_t id = (uint32_t)strings.size();
+        strings.push_back(text);
+        ids.emplace(text, id);
+        return id;
+    }
+
+    const string& lookup(uint32_t id) const { return strings[id]; }
+    size_t size() const { return strings.size(); }
+};
+
+// Inventory Kernels
+// Aggregation loops over InventoryColumns. On x86 the widest supported of
+// AVX2 / SSE2 is picked once at runtime; other targets use the scalar loops.
+// Price columns hold whole cents in double lanes: products and sums of integers stay
+// exact below 2^53, so money totals come out exact at floating-point speed.
+struct InventoryKernelTable {
+    const char* isa;
+    // Number of rows with values[i] <= limit
+    size_t (*countAtMost)(const int* values, size_t n, int limit);
+    // sum(quantity[i] * price[i])
+    double (*weightedSum)(const int* quantity, const double* price, size_t n);
+    // out[i] = (sellPrice[i] - buyPrice[i]) * quantity[i]
+    void (*marginOnStock)(const double* sellPrice, const double* buyPrice, const int* quantity, double* out, size_t n);
+};
+
+static size_t countAtMostScalar(const int* values, size_t n, int limit) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) count += values[i] <= limit;
+    return count;
+}
+
+static double weightedSumScalar(const int* quantity, const double* price, size_t n) {
+    double total = 0.0;
+    for (size_t i = 0; i < n; i++) total += quantity[i] * price[i];
+    return total;
+}
+
+static void marginOnStockScalar(const double* sellPrice, const double* buyPrice, const int* quantity, double* out, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = (sellPrice[i] - buyPrice[i]) * quantity[i];
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define INVENTORY_KERNELS_X86
+
+__attribute__((target("sse2")))
+static size_t countAtMostSSE2(const int* values, size_t n, int limit) {
+    size_t count = 0, i = 0;
+    __m128i bound = _mm_set1_epi32(limit);
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(values + i));
+        unsigned over = (unsigned)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, bound)));
+        count += 4 - __builtin_popcount(over);
+    }
+    for (; i < n; i++) count += values[i] <= limit;
+    return count;
+}
+
+__attribute__((target("sse2")))
+static double weightedSumSSE2(const int* quantity, const double* price, size_t n) {
+    size_t i = 0;
+    __m128d sum0 = _mm_setzero_pd(), sum1 = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        __m128i q = _mm_loadu_si128((const __m128i*)(quantity + i));
+        __m128d lo = _mm_cvtepi32_pd(q);
+        __m128d hi = _mm_cvtepi32_pd(_mm_shuffle_epi32(q, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum0 = _mm_add_pd(sum0, _mm_mul_pd(lo, _mm_loadu_pd(price + i)));
+        sum1 = _mm_add_pd(sum1, _mm_mul_pd(hi, _mm_loadu_pd(price + i + 2)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(sum0, sum1));
+    double total = lanes[0] + lanes[1];
+    for (; i < n; i++) total += quantity[i] * price[i];
+    return total;
+}
+
+__attribute__((target("sse2")))
+static void marginOnStockSSE2(const double* sellPrice, const double* buyPrice, const int* quantity, double* out, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d q = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i*)(quantity + i)));
+        __m128d margin = _mm_sub_pd(_mm_loadu_pd(sellPrice + i), _mm_loadu_pd(buyPrice + i));
+        _mm_storeu_pd(out + i, _mm_mul_pd(margin, q));
+    }
+    for (; i < n; i++) out[i] = (sellPrice[i] - buyPrice[i]) * quantity[i];
+}
+
+__attribute__((target("avx2,popcnt")))
+static size_t countAtMostAVX2(const int* values, size_t n, int limit) {
+    size_t count = 0, i = 0;
+    __m256i bound = _mm256_set1_epi32(limit);
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(values + i));
+        unsigned over = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, bound)));
+        count += 8 - __builtin_popcount(over);
+    }
+    for (; i < n; i++) count += values[i] <= limit;
+    return count;
+}
+
+__attribute__((target("avx2")))
+static double weightedSumAVX2(const int* quantity, const double* price, size_t n) {
+    size_t i = 0;
+    __m256d sum0 = _mm256_setzero_pd(), sum1 = _mm256_setzero_pd();
+    for (; i + 8 <= n; i += 8) {
+        __m256d lo = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(quantity + i)));
+        __m256d hi = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(quantity + i + 4)));
+        sum0 = _mm256_add_pd(sum0, _mm256_mul_pd(lo, _mm256_loadu_pd(price + i)));
+        sum1 = _mm256_add_pd(sum1, _mm256_mul_pd(hi, _mm256_loadu_pd(price + i + 4)));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(sum0, sum1));
+    double total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < n; i++) total += quantity[i] * price[i];
+    return total;
+}
+
+__attribute__((target("avx2")))
+static void marginOnStockAVX2(const double* sellPrice, const double* buyPrice, const int* quantity, double* out, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d q = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(quantity + i)));
+        __m256d margin = _mm256_sub_pd(_mm256_loadu_pd(sellPrice + i), _mm256_loadu_pd(buyPrice + i));
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(margin, q));
+    }
+    for (; i < n; i++) out[i] = (sellPrice[i] - buyPrice[i]) * quantity[i];
+}
+#endif
+
+// Every kernel set this CPU can run, widest first; the scalar loops always come last
+static vector<InventoryKernelTable> supportedInventoryKernels() {
+    vector<InventoryKernelTable> tables;
+#ifdef INVENTORY_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        tables.push_back(InventoryKernelTable{"AVX2", countAtMostAVX2, weightedSumAVX2, marginOnStockAVX2});
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        tables.push_back(InventoryKernelTable{"SSE2", countAtMostSSE2, weightedSumSSE2, marginOnStockSSE2});
+    }
+#endif
+    tables.push_back(InventoryKernelTable{"Scalar", countAtMostScalar, weightedSumScalar, marginOnStockScalar});
+    return tables;
+}
+
+static const InventoryKernelTable& inventoryKernels() {
+    static const InventoryKernelTable table = supportedInventoryKernels().front();
+    return table;
+}
+
+// Promotion Rule Class
+// One pricing rule as data. Empty season/category/promoCode match anything; the rule
+// applies to products whose demand lies in [minDemand, maxDemand]. adjustmentPercent
+// changes the price (-15 for 15% off, +20 for a 20% rise). Matching rules apply in
+// descending priority; a non-stackable rule ends evaluation once it has applied.
+struct PromotionRule {
+    string name;
+    string season;
+    string category;
+    int minDemand = INT_MIN;
+    int maxDemand = INT_MAX;
+    string promoCode;
+    double adjustmentPercent = 0;
+    int priority = 0;
+    bool stackable = true;
+};
+
+// Promotion Table Class
+// Rules compiled for one season and promo code into a decision table indexed by category:
+// each slot holds the rules reaching that category (its own plus wildcard ones) in
+// evaluation order, so pricing a product is a slot lookup plus a short scan.
+class PromotionTable {
+private:
+    struct CompiledRule {
+        int minDemand;
+        int maxDemand;
+        int64_t rateBasisPoints;  // New price as a fraction of the old, 10000 = unchanged
+        bool stackable;
+    };
+
+    unordered_map<string, uint32_t> categorySlots;
+    vector<vector<CompiledRule>> slots;  // Slot 0: categories without rules of their own
+
+public:
+    PromotionTable() : slots(1) {}
+
+    PromotionTable(const vector<PromotionRule>& rules, const string& season, const string& promoCode) : slots(1) {
+        vector<const PromotionRule*> active;
+        for (const auto& rule : rules) {
+            if ((rule.season.empty() || rule.season == season) &&
+                (rule.promoCode.empty() || rule.promoCode == promoCode)) {
+                active.push_back(&rule);
+            }
+        }
+        stable_sort(active.begin(), active.end(),
+                    [](const PromotionRule* a, const PromotionRule* b) { return a->priority > b->priority; });
+
+        for (const PromotionRule* rule : active) {
+            if (!rule->category.empty() && categorySlots.emplace(rule->category, (uint32_t)slots.size()).second) {
+                slots.emplace_back();
+            }
+        }
+        for (const PromotionRule* rule : active) {
+            CompiledRule compiled{rule->minDemand, rule->maxDemand,
+                                  10000 + llround(rule->adjustmentPercent * 100), rule->stackable};
+            if (rule->category.empty()) {
+                for (auto& slot : slots) slot.push_back(compiled);
+            } else {
+                slots[categorySlots[rule->category]].push_back(compiled);
+            }
+        }
+    }
+
+    bool empty() const {
+        for (const auto& slot : slots) {
+            if (!slot.empty()) return false;
+        }
+        return true;
+    }
+
+    uint32_t slotFor(const string& category) const {
+        auto found = categorySlots.find(category);
+        return found == categorySlots.end() ? 0 : found->second;
+    }
+
+    Money price(uint32_t slot, Money base, int demand) const {
+        for (const CompiledRule& rule : slots[slot]) {
+            if (demand < rule.minDemand || demand > rule.maxDemand) continue;
+            base = base.applyRate(rule.rateBasisPoints);
+            if (!rule.stackable) break;
+        }
+        return base;
+    }
+
+    Money price(const string& category, Money base, int demand) const {
+        return price(slotFor(category), base, demand);
+    }
+};
+
+// Inventory Columns Class
+// Structure-of-arrays copy of the numeric product fields for full-catalog scans.
+// Category and supplier are interned; names stay on the ItemNode.
+// Row order is arbitrary; removal swaps the last row into the hole.
+class InventoryColumns {
+private:
+    vector<ItemNode*> items;
+    vector<int> quantity;
+    vector<int> expiryDay;
+    vector<int> discount;
+    vector<int> demand;
+    vector<double> sellPrice;  // Whole cents (see Inventory Kernels)
+    vector<double> listPrice;
+    vector<double> buyPrice;
+    vector<uint32_t> categoryID;
+    vector<uint32_t> supplierID;
+    StringPool strings;
+
+    void store(size_t row, const ItemNode* item) {
+        store(row, item, strings.intern(item->category), strings.intern(item->supplierName));
+    }
+
+    void store(size_t row, const ItemNode* item, uint32_t category, uint32_t supplier) {
+        quantity[row] = item->quantity;
+        expiryDay[row] = (int)item->expiryDay;
+        discount[row] = item->discount;
+        demand[row] = item->demand;
+        sellPrice[row] = (double)item->sellPrice.minorUnits();
+        listPrice[row] = (double)item->listPrice.minorUnits();
+        buyPrice[row] = (double)item->buyPrice.minorUnits();
+        categoryID[row] = category;
+        supplierID[row] = supplier;
+    }
+
+public:
+    size_t size() const { return items.size(); }
+    const StringPool& pool() const { return strings; }
+
+    void reserve(size_t count) {
+        items.reserve(count);
+        quantity.reserve(count);
+        expiryDay.reserve(count);
+        discount.reserve(count);
+        demand.reserve(count);
+        sellPrice.reserve(count);
+        listPrice.reserve(count);
+        buyPrice.reserve(count);
+        categoryID.reserve(count);
+        supplierID.reserve(count);
+    }
+
+    // Bulk loads intern each distinct category and supplier once and append with the IDs
+    uint32_t intern(const string& text) {
+        return strings.intern(text);
+    }
+
+    void append(ItemNode* item) {
+        append(item, strings.intern(item->category), strings.intern(item->supplierName));
+    }
+
+    void append(ItemNode* item, uint32_t category, uint32_t supplier) {
+        item->row = items.size();
+        items.push_back(item);
+        quantity.push_back(0);
+        expiryDay.push_back(0);
+        discount.push_back(0);
+        demand.push_back(0);
+        sellPrice.push_back(0);
+        listPrice.push_back(0);
+        buyPrice.push_back(0);
+        categoryID.push_back(0);
+        supplierID.push_back(0);
+        store(item->row, item, category, supplier);
+    }
+
+    // Copy the product's current field values into its row
+    void refresh(const ItemNode* item) {
+        store(item->row, item);
+    }
+
+    // Copy only the quantity; safe to call concurrently for different products
+    void refreshQuantity(const ItemNode* item) {
+        quantity[item->row] = item->quantity;
+    }
+
+    void remove(const ItemNode* item) {
+        size_t row = item->row;
+        size_t last = items.size() - 1;
+        if (row != last) {
+            items[row] = items[last];
+            items[row]->row = row;
+            quantity[row] = quantity[last];
+            expiryDay[row] = expiryDay[last];
+            discount[row] = discount[last];
+            demand[row] = demand[last];
+            sellPrice[row] = sellPrice[last];
+            listPrice[row] = listPrice[last];
+            buyPrice[row] = buyPrice[last];
+            categoryID[row] = categoryID[last];
+            supplierID[row] = supplierID[last];
+        }
+        items.pop_back();
+        quantity.pop_back();
+        expiryDay.pop_back();
+        discount.pop_back();
+        demand.pop_back();
+        sellPrice.pop_back();
+        listPrice.pop_back();
+        buyPrice.pop_back();
+        categoryID.pop_back();
+        supplierID.pop_back();
+    }
+
+    // Total purchase value of the stock on hand: sum(quantity * buyPrice)
+    Money totalStockValue() const {
+        return Money::fromCents(llround(inventoryKernels().weightedSum(quantity.data(), buyPrice.data(), quantity.size())));
+    }
+
+    // Number of products expiring on or before the given day
+    size_t countExpiringBy(int64_t day) const {
+        return inventoryKernels().countAtMost(expiryDay.data(), expiryDay.size(), (int)day);
+    }
+
+    // Price every row's list price with a promotion table in one pass; collects the rows
+    // whose sell price changes
+    void evaluatePrices(const PromotionTable& table, vector<pair<ItemNode*, Money>>& changed) const {
+        vector<uint32_t> slotOf(strings.size());
+        for (size_t id = 0; id < slotOf.size(); id++) slotOf[id] = table.slotFor(strings.lookup((uint32_t)id));
+        for (size_t row = 0; row < items.size(); row++) {
+            Money price = table.price(slotOf[categoryID[row]], Money::fromCents((int64_t)listPrice[row]), demand[row]);
+            if (price != Money::fromCents((int64_t)sellPrice[row])) changed.push_back({items[row], price});
+        }
+    }
+
+    // Copy only the sell and list prices
+    void refreshPrices(const ItemNode* item) {
+        sellPrice[item->row] = (double)item->sellPrice.minorUnits();
+        listPrice[item->row] = (double)item->listPrice.minorUnits();
+    }
+
+    // Copy only the demand
+    void refreshDemand(const ItemNode* item) {
+        demand[item->row] = item->demand;
+    }
+
+    struct CategoryStock {
+        int64_t units = 0;
+        Money stockValue;  // sum(quantity * buyPrice)
+        size_t products = 0;
+    };
+
+    // Units, purchase value and product count of the stock on hand per category
+    map<string, CategoryStock> stockByCategory() const {
+        vector<CategoryStock> totals(strings.size());
+        for (size_t row = 0; row < quantity.size(); row++) {
+            CategoryStock& category = totals[categoryID[row]];
+            category.units += quantity[row];
+            category.stockValue += Money::fromCents((int64_t)buyPrice[row]) * quantity[row];
+            category.products++;
+        }
+        map<string, CategoryStock> result;
+        for (size_t id = 0; id < totals.size(); id++) {
+            if (totals[id].products) result[strings.lookup((uint32_t)id)] = totals[id];
+        }
+        return result;
+    }
+
+    // Margin on stock on hand per category: sum((sellPrice - buyPrice) * quantity)
+    map<string, Money> marginByCategory() const {
+        vector<double> rowMargin(quantity.size());
+        inventoryKernels().marginOnStock(sellPrice.data(), buyPrice.data(), quantity.data(), rowMargin.data(), quantity.size());
+        vector<double> margin(strings.size(), 0.0);
+        for (size_t i = 0; i < rowMargin.size(); i++) {
+            margin[categoryID[i]] += rowMargin[i];
+        }
+        vector<bool> present(strings.size(), false);
+        for (uint32_t id : categoryID) present[id] = true;
+
+        map<string, Money> result;
+        for (size_t id = 0; id < margin.size(); id++) {
+            if (present[id]) result[strings.lookup((uint32_t)id)] = Money::fromCents(llround(margin[id]));
+        }
+        return result;
+    }
+};
+
+// Stock Alerts Class
+// Raises a low-stock alert as soon as a quantity change takes a product below its threshold
+// (its own, else its category's, else the default), and an expiry alert when a product
+// comes within warningDays of expiring. Expiries sit in a timer wheel of day slots that is
+// turned by advance(), so neither kind of alert needs a catalog scan.
+class StockAlerts {
+public:
+    enum Kind : uint8_t { LOW_STOCK, EXPIRING };
+
+    struct Alert {
+        Kind kind;
+        int productID;
+        string name;
+        int value;    // Quantity left, or days until expiry
+        int64_t day;  // Day raised, in days since the Unix epoch
+    };
+
+private:
+    static constexpr size_t WHEEL_DAYS = 64;
+    static constexpr size_t HISTORY_LIMIT = 1024;
+
+    struct Timer {
+        int productID;
+        int64_t alertDay;
+    };
+
+    struct Expiry {
+        const ItemNode* item;
+        int64_t expiryDay;
+        int64_t alertDay;
+    };
+
+    int defaultThreshold;
+    int warningDays;
+    unordered_map<int, int> productThresholds;
+    unordered_map<string, int> categoryThresholds;
+    unordered_map<int, const ItemNode*> lowStock;  // Products with an open low-stock alert
+    unordered_map<int, Expiry> expiries;           // Pending expiry alerts by product ID
+    vector<Timer> wheel[WHEEL_DAYS];               // Slot alertDay % WHEEL_DAYS; later laps stay put
+    int64_t currentDay;
+    deque<Alert> history;
+    OperationLog* operations;
+    mutable mutex lock;
+
+    void raise(Kind kind, const ItemNode* item, int value) {
+        history.push_back({kind, item->ID, item->name, value, currentDay});
+        if (history.size() > HISTORY_LIMIT) history.pop_front();
+        if (operations) {
+            operations->log(kind == LOW_STOCK ? OperationLog::LOW_STOCK_ALERT : OperationLog::EXPIRY_ALERT,
+                            OperationLog::SYSTEM, item->ID, value);
+        }
+    }
+
+    int thresholdLocked(const ItemNode* item) const {
+        auto product = productThresholds.find(item->ID);
+        if (product != productThresholds.end()) return product->second;
+        auto category = categoryThresholds.find(item->category);
+        return category != categoryThresholds.end() ? category->second : defaultThreshold;
+    }
+
+    void checkStockLocked(const ItemNode* item, int quantity) {
+        if (quantity < thresholdLocked(item)) {
+            if (lowStock.emplace(item->ID, item).second) raise(LOW_STOCK, item, quantity);
+        } else {
+            lowStock.erase(item->ID);
+        }
+    }
+
+    // Fire the timers in one slot that are due by currentDay; drop cancelled ones
+    void fireSlot(vector<Timer>& slot) {
+        size_t kept = 0;
+        for (const Timer& timer : slot) {
+            auto expiry = expiries.find(timer.productID);
+            if (expiry == expiries.end() || expiry->second.alertDay != timer.alertDay) continue;
+            if (timer.alertDay > currentDay) {
+                slot[kept++] = timer;
+                continue;
+            }
+            raise(EXPIRING, expiry->second.item, (int)(expiry->second.expiryDay - currentDay));
+            expiries.erase(expiry);
+        }
+        slot.resize(kept);
+    }
+
+    void scheduleLocked(const ItemNode* item) {
+        Expiry expiry{item, item->expiryDay, item->expiryDay - warningDays};
+        if (expiry.alertDay <= currentDay) {
+            expiries.erase(item->ID);
+            raise(EXPIRING, item, (int)(item->expiryDay - currentDay));
+            return;
+        }
+        expiries[item->ID] = expiry;
+        wheel[expiry.alertDay % WHEEL_DAYS].push_back({item->ID, expiry.alertDay});
+    }
+
+public:
+    StockAlerts() : defaultThreshold(5), warningDays(7), currentDay(today()), operations(nullptr) {}
+
+    StockAlerts(const StockAlerts&) = delete;
+    StockAlerts& operator=(const StockAlerts&) = delete;
+
+    // Days since the Unix epoch
+    static int64_t today() {
+        return chrono::duration_cast<chrono::hours>(chrono::system_clock::now().time_since_epoch()).count() / 24;
+    }
+
+    // Also record every alert in an operation log (nullptr to stop)
+    void attachOperationLog(OperationLog* log) {
+        lock_guard<mutex> guard(lock);
+        operations = log;
+    }
+
+    void setDefaultThreshold(int threshold) {
+        lock_guard<mutex> guard(lock);
+        defaultThreshold = threshold;
+    }
+
+    void setProductThreshold(int productID, int threshold) {
+        lock_guard<mutex> guard(lock);
+        productThresholds[productID] = threshold;
+    }
+
+    void setCategoryThreshold(const string& category, int threshold) {
+        lock_guard<mutex> guard(lock);
+        categoryThresholds[category] = threshold;
+    }
+
+    // Applies to expiries scheduled from now on
+    void setWarningDays(int days) {
+        lock_guard<mutex> guard(lock);
+        warningDays = days;
+    }
+
+    int thresholdFor(const ItemNode* item) const {
+        lock_guard<mutex> guard(lock);
+        return thresholdLocked(item);
+    }
+
+    // Re-check a product after its quantity (or threshold) changed. The caller must keep
+    // the quantity from changing during the call.
+    void stockChanged(const ItemNode* item) {
+        lock_guard<mutex> guard(lock);
+        checkStockLocked(item, item->quantity);
+    }
+
+    // Same, with the quantity read by the caller under its own lock; checkout lanes report
+    // after releasing their stock locks, so only falling quantities may arrive out of order
+    void stockChanged(const ItemNode* item, int quantity) {
+        lock_guard<mutex> guard(lock);
+        checkStockLocked(item, quantity);
+    }
+
+    // (Re)start the product's expiry clock from its expiry day
+    void scheduleExpiry(const ItemNode* item) {
+        lock_guard<mutex> guard(lock);
+        scheduleLocked(item);
+    }
+
+    // stockChanged and scheduleExpiry for a batch of new products, under one lock
+    void trackAll(const vector<const ItemNode*>& items) {
+        lock_guard<mutex> guard(lock);
+        expiries.reserve(expiries.size() + items.size());
+        for (const ItemNode* item : items) {
+            checkStockLocked(item, item->quantity);
+            scheduleLocked(item);
+        }
+    }
+
+    // Stop alerting for a removed product
+    void forget(int productID) {
+        lock_guard<mutex> guard(lock);
+        lowStock.erase(productID);
+        expiries.erase(productID);
+    }
+
+    // Turn the wheel to day, firing every expiry alert that came due on the way
+    void advance(int64_t day = today()) {
+        lock_guard<mutex> guard(lock);
+        if (day <= currentDay) return;
+        int64_t first = max(currentDay + 1, day - (int64_t)WHEEL_DAYS + 1);
+        currentDay = day;
+        for (int64_t slot = first; slot <= day; slot++) fireSlot(wheel[slot % WHEEL_DAYS]);
+    }
+
+    // Up to count of the most recent alerts, newest first
+    vector<Alert> recent(size_t count) const {
+        lock_guard<mutex> guard(lock);
+        vector<Alert> result;
+        for (auto alert = history.rbegin(); alert != history.rend() && result.size() < count; ++alert) {
+            result.push_back(*alert);
+        }
+        return result;
+    }
+
+    // Products currently below their threshold
+    vector<const ItemNode*> lowStockItems() const {
+        lock_guard<mutex> guard(lock);
+        vector<const ItemNode*> items;
+        items.reserve(lowStock.size());
+        for (const auto& entry : lowStock) items.push_back(entry.second);
+        return items;
+    }
+};
+
+class InventoryManagement {
+private:
+    ObjectPool<ItemNode> itemPool;  // Storage for the canonical product records
+    ItemNode* head;
+    ItemNode* tail;
+    ProductIndex index;     // ID lookup for update/remove/categorize
+    ProductTree catalog;    // Balanced ordered index of categorized products
+    ProductSearchEngine searchEngine;  // Type-ahead name search
+    InventoryColumns columns;          // Contiguous numeric fields for reports
+    unordered_multimap<string, int> nameIndex;                // name -> product IDs
+    unordered_map<string, unordered_set<int>> categoryIndex;  // category -> product IDs
+    bool secondaryIndexesBuilt;  // false after a bulk load until the first name/category search
+    WriteAheadLog* journal;      // Mutation log, if attached
+    string promotionSeason;      // Active promotion the sell prices are derived with
+    string promotionCode;
+    PromotionTable pricing;      // Rules of the last pricing pass, for products updated between passes
+    StockAlerts alerts;          // Low-stock thresholds and expiry timers
+
+    // Held exclusively while products are added, changed or removed, and shared by chain
+    // queries from other threads (see StoreNetwork)
+    mutable shared_mutex catalogLock;
+
+    // Striped locks guarding ItemNode::quantity during concurrent checkouts. Each stripe
+    // also guards the stock-level heap of its products, so lanes never share a lock
+    // unless they share a stripe.
+    static constexpr size_t STOCK_LOCK_STRIPES = 64;
+    mutable mutex stockLocks[STOCK_LOCK_STRIPES];
+    IndexedMinHeap stockLevels[STOCK_LOCK_STRIPES];  // Product IDs by quantity, lowest first
+
+    static size_t stockStripe(int ID) {
+        return (size_t)((uint32_t)ID * 2654435761u) % STOCK_LOCK_STRIPES;
+    }
+
+    // One product in a snapshot. Rows are fixed width and point into a shared name blob
+    // and string table, so loading copies rows instead of decoding fields one at a time.
+    struct SnapshotRow {
+        int32_t ID, quantity, discount, demand;
+        int64_t expiryDay;
+        int64_t buyCents, listCents;   // Dynamic prices are recomputed after loading
+        uint32_t nameOffset, nameLength;  // Into the name blob
+        uint32_t category, supplier;      // Into the string table
+        uint32_t categorized;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(SnapshotRow) == 64, "snapshot rows are stored as raw bytes");
+
+    // Name-keyed indexes: exact-name lookup and type-ahead search
+    void indexName(ItemNode* item) {
+        if (!secondaryIndexesBuilt) return;
+        nameIndex.emplace(item->name, item->ID);
+        searchEngine.addProduct(item);
+    }
+
+    void unindexName(const ItemNode* item) {
+        if (!secondaryIndexesBuilt) return;
+        auto range = nameIndex.equal_range(item->name);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == item->ID) {
+                nameIndex.erase(it);
+                break;
+            }
+        }
+        searchEngine.removeProduct(item->ID);
+    }
+
+    void indexCategory(const ItemNode* item) {
+        if (!secondaryIndexesBuilt) return;
+        categoryIndex[item->category].insert(item->ID);
+    }
+
+    void unindexCategory(const ItemNode* item) {
+        if (!secondaryIndexesBuilt) return;
+        auto entry = categoryIndex.find(item->category);
+        if (entry == categoryIndex.end()) return;
+        entry->second.erase(item->ID);
+        if (entry->second.empty()) categoryIndex.erase(entry);
+    }
+
+    void ensureSecondaryIndexes() {
+        if (secondaryIndexesBuilt) return;
+        secondaryIndexesBuilt = true;
+        nameIndex.reserve(index.size());
+        for (ItemNode* item = head; item; item = item->next) {
+            nameIndex.emplace(item->name, item->ID);
+            searchEngine.loadProduct(item);
+            indexCategory(item);
+        }
+        searchEngine.compact();
+    }
+
+    void trackStock(const ItemNode* item) {
+        size_t stripe = stockStripe(item->ID);
+        lock_guard<mutex> guard(stockLocks[stripe]);
+        stockLevels[stripe].set(item->ID, item->quantity);
+    }
+
+    static void printProduct(const ItemNode* item) {
+        cout << "Product found: " << item->name << " (" << item->category << ")" << endl;
+        cout << "ID: " << item->ID << ", Price: $" << item->sellPrice << ", Quantity: " << item->quantity << endl;
+    }
+
+public:
+    // Constructor
+    InventoryManagement() : head(nullptr), tail(nullptr), secondaryIndexesBuilt(true), journal(nullptr) {}
+
+    // Destructor
+    ~InventoryManagement() {
+        ItemNode* current = head;
+        while (current) {
+            ItemNode* next = current->next;
+            itemPool.destroy(current);
+            current = next;
+        }
+    }
+
+    InventoryManagement(const InventoryManagement&) = delete;
+    InventoryManagement& operator=(const InventoryManagement&) = delete;
+
+    // Pre-allocate storage ahead of a bulk catalog load
+    void reserveProducts(size_t count) {
+        itemPool.reserve(count);
+        index.reserve(count);
+        columns.reserve(count);
+        for (IndexedMinHeap& levels : stockLevels) levels.reserve(count / STOCK_LOCK_STRIPES + 1);
+    }
+
+    // The count products with the least stock, lowest first; merges the lowest entries of
+    // each stripe's heap without touching the rest of the catalog
+    vector<pair<ItemNode*, int>> lowestStock(size_t count) const {
+        vector<IndexedMinHeap::Entry> candidates;
+        for (size_t stripe = 0; stripe < STOCK_LOCK_STRIPES; stripe++) {
+            lock_guard<mutex> guard(stockLocks[stripe]);
+            vector<IndexedMinHeap::Entry> lowest = stockLevels[stripe].lowest(count);
+            candidates.insert(candidates.end(), lowest.begin(), lowest.end());
+        }
+        size_t kept = min(count, candidates.size());
+        partial_sort(candidates.begin(), candidates.begin() + kept, candidates.end(),
+                     [](const IndexedMinHeap::Entry& a, const IndexedMinHeap::Entry& b) {
+                         return a.priority != b.priority ? a.priority < b.priority : a.key < b.key;
+                     });
+        vector<pair<ItemNode*, int>> result;
+        for (size_t i = 0; i < kept; i++) result.push_back({index.find(candidates[i].key), (int)candidates[i].priority});
+        return result;
+    }
+
+    // Products with stock below threshold, lowest first
+    vector<pair<ItemNode*, int>> stockBelow(int threshold) const {
+        vector<pair<ItemNode*, int>> result;
+        for (size_t stripe = 0; stripe < STOCK_LOCK_STRIPES; stripe++) {
+            lock_guard<mutex> guard(stockLocks[stripe]);
+            stockLevels[stripe].forEachBelow(threshold, [&](const IndexedMinHeap::Entry& entry) {
+                result.push_back({index.find(entry.key), (int)entry.priority});
+            });
+        }
+        sort(result.begin(), result.end(), [](const pair<ItemNode*, int>& a, const pair<ItemNode*, int>& b) {
+            return a.second != b.second ? a.second < b.second : a.first->ID < b.first->ID;
+        });
+        return result;
+    }
+
+    // Alerts raised by stock changes and expiry dates
+    StockAlerts& stockAlerts() {
+        return alerts;
+    }
+
+    // Fire any expiry alerts due today
+    void checkExpiry() {
+        alerts.advance();
+    }
+
+    // Low-stock threshold for products without their own or a category threshold
+    void setDefaultLowStockThreshold(int threshold) {
+        alerts.setDefaultThreshold(threshold);
+        for (ItemNode* item = head; item; item = item->next) alerts.stockChanged(item);
+    }
+
+    // Low-stock threshold for one product; takes precedence over its category's
+    void setLowStockThreshold(int ID, int threshold) {
+        alerts.setProductThreshold(ID, threshold);
+        if (ItemNode* item = index.find(ID)) alerts.stockChanged(item);
+    }
+
+    // Low-stock threshold for every product in a category without its own
+    void setCategoryLowStockThreshold(const string& category, int threshold) {
+        alerts.setCategoryThreshold(category, threshold);
+        ensureSecondaryIndexes();
+        auto members = categoryIndex.find(category);
+        if (members == categoryIndex.end()) return;
+        for (int ID : members->second) alerts.stockChanged(index.find(ID));
+    }
+
+    struct ReorderLine {
+        const ItemNode* item;
+        int threshold;
+        int quantity;  // Units to order
+    };
+
+    // Restock suggestions for every product below its threshold, grouped by supplier.
+    // Each order brings stock to the threshold plus coverDays of demand at unitsPerDay
+    // (at least twice the threshold).
+    map<string, vector<ReorderLine>> reorderSuggestions(const function<double(int)>& unitsPerDay, int coverDays = 7) const {
+        map<string, vector<ReorderLine>> bySupplier;
+        for (const ItemNode* item : alerts.lowStockItems()) {
+            int threshold = alerts.thresholdFor(item);
+            int target = max(2 * threshold, threshold + (int)ceil(unitsPerDay(item->ID) * coverDays));
+            if (target > item->quantity) bySupplier[item->supplierName].push_back({item, threshold, target - item->quantity});
+        }
+        for (auto& entry : bySupplier) {
+            sort(entry.second.begin(), entry.second.end(),
+                 [](const ReorderLine& a, const ReorderLine& b) { return a.item->ID < b.item->ID; });
+        }
+        return bySupplier;
+    }
+
+    // Stock on hand per category, from the column store. Safe to call while checkouts and
+    // catalog changes run on other threads: every stock stripe is held for the scan.
+    map<string, InventoryColumns::CategoryStock> stockByCategory() const {
+        shared_lock<shared_mutex> catalogGuard(catalogLock);
+        for (mutex& stripe : stockLocks) stripe.lock();
+        map<string, InventoryColumns::CategoryStock> result = columns.stockByCategory();
+        for (mutex& stripe : stockLocks) stripe.unlock();
+        return result;
+    }
+
+    // Units of a product on hand, or -1 if it is not carried. Safe to call while checkouts
+    // and catalog changes run on other threads.
+    int stockOf(int ID) const {
+        shared_lock<shared_mutex> catalogGuard(catalogLock);
+        ItemNode* item = index.find(ID);
+        if (!item) return -1;
+        lock_guard<mutex> guard(stockLocks[stockStripe(ID)]);
+        return item->quantity;
+    }
+
+    // Category of a tracked product, or "" if it is not in the inventory
+    string categoryOf(int ID) const {
+        ItemNode* item = index.find(ID);
+        return item ? item->category : string();
+    }
+
+    // Record every subsequent mutation in the log (nullptr to stop)
+    void attachLog(WriteAheadLog* log) {
+        journal = log;
+    }
+
+    // Take the cart's quantities out of stock, all or nothing. Safe to call from several
+    // checkout lanes at once and alongside product changes: the catalog lock is held shared,
+    // so adds, updates and removals wait for it. onReserved runs after a successful
+    // reservation, still under that lock, so a checkout it journals is ordered against the
+    // journaled product changes the same way as the stock itself.
+    // Items not tracked in the inventory are ignored. Returns 0 on success, otherwise
+    // the ID of the first line with a non-positive quantity or without enough stock.
+    int reserveStock(const vector<CartItem>& cart, const function<void()>& onReserved = nullptr) {
+        shared_lock<shared_mutex> catalogGuard(catalogLock);
+        vector<pair<ItemNode*, int>> lines;
+        for (const auto& item : cart) {
+            if (item.quantity <= 0) return item.ID;  // Would put stock back instead of taking it
+            ItemNode* product = index.find(item.ID);
+            if (!product) continue;
+            auto line = find_if(lines.begin(), lines.end(),
+                                [&](const pair<ItemNode*, int>& entry) { return entry.first == product; });
+            if (line != lines.end()) {
+                line->second += item.quantity;
+            } else {
+                lines.push_back({product, item.quantity});
+            }
+        }
+        if (lines.empty()) {
+            if (onReserved) onReserved();
+            return 0;
+        }
+
+        // Lock stripes in ascending order so concurrent carts cannot deadlock
+        vector<size_t> stripes;
+        for (const auto& line : lines) stripes.push_back(stockStripe(line.first->ID));
+        sort(stripes.begin(), stripes.end());
+        stripes.erase(unique(stripes.begin(), stripes.end()), stripes.end());
+        for (size_t stripe : stripes) stockLocks[stripe].lock();
+
+        int shortID = 0;
+        for (const auto& line : lines) {
+            if (line.first->quantity < line.second) {
+                shortID = line.first->ID;
+                break;
+            }
+        }
+        if (!shortID) {
+            for (auto& line : lines) {
+                line.first->quantity -= line.second;
+                line.second = line.first->quantity;  // The new level, for the alerts below
+                columns.refreshQuantity(line.first);
+                stockLevels[stockStripe(line.first->ID)].set(line.first->ID, line.first->quantity);
+            }
+        }
+
+        for (size_t stripe : stripes) stockLocks[stripe].unlock();
+        // Alerts share one lock across the store; check them once the stripes are released
+        if (!shortID) {
+            for (const auto& line : lines) alerts.stockChanged(line.first, line.second);
+            if (onReserved) onReserved();
+        }
+        return shortID;
+    }
+
+    // Make logged insertProduct calls durable (bulk loaders call this once per batch)
+    bool commitLog() {
+        return !journal || journal->commit();
+    }
+
+    // Bulk loads skip the name/category indexes; they are rebuilt on first use
+    void deferSecondaryIndexes() {
+        nameIndex.clear();
+        categoryIndex.clear();
+        searchEngine = ProductSearchEngine();
+        secondaryIndexesBuilt = false;
+    }
+
+    // Insert Product without console output; returns nullptr if the ID already exists
+    ItemNode* insertProduct(int ID, int quantity, int64_t expiryDay, int discount, Money sellPrice, Money buyPrice, const string& name, const string& category, const string& supplierName, int demand) {
+        unique_lock<shared_mutex> catalogGuard(catalogLock);
+        if (index.find(ID)) return nullptr;
+        ItemNode* newItem = itemPool.create(ID, quantity, expiryDay, discount, sellPrice, buyPrice, name, category, supplierName, demand);
+        if (!head) {
+            head = tail = newItem;
+        } else {
+            tail->next = newItem;
+            newItem->prev = tail;
+            tail = newItem;
+        }
+        index.insert(ID, newItem);
+        indexName(newItem);
+        indexCategory(newItem);
+        columns.append(newItem);
+        trackStock(newItem);
+        alerts.stockChanged(newItem);
+        alerts.scheduleExpiry(newItem);
+
+        if (journal) {
+            SnapshotBuffer record;
+            record.put<int32_t>(ID);
+            record.put<int32_t>(quantity);
+            record.put<int64_t>(expiryDay);
+            record.put<int32_t>(discount);
+            record.put<int32_t>(demand);
+            record.putMoney(sellPrice);
+            record.putMoney(buyPrice);
+            record.putString(name);
+            record.putString(category);
+            record.putString(supplierName);
+            journal->append(WriteAheadLog::ADD_PRODUCT, record);
+        }
+        return newItem;
+    }
+
+    // Add Product; expiryDay is absolute (see StockAlerts::today)
+    void addProduct(int ID, int quantity, int64_t expiryDay, int discount, Money sellPrice, Money buyPrice, string name, string category, string supplierName, int demand) {
+        if (!insertProduct(ID, quantity, expiryDay, discount, sellPrice, buyPrice, name, category, supplierName, demand)) {
+            cout << "Product with ID " << ID << " already exists.\n";
+            return;
+        }
+        if (journal) journal->commit();
+        cout << "Product added successfully: " << name << endl;
+    }
+
+    size_t productCount() const {
+        return index.size();
+    }
+
+    // Write every product (and whether it is categorized) to a snapshot section:
+    // [uint64 count][uint32 string count][strings][uint64 name bytes][names][count rows]
+    void writeSnapshot(SnapshotBuffer& out) const {
+        vector<const string*> strings;
+        unordered_map<string_view, uint32_t> stringIDs;
+        auto intern = [&](const string& text) {
+            auto entry = stringIDs.emplace(text, (uint32_t)strings.size());
+            if (entry.second) strings.push_back(&text);
+            return entry.first->second;
+        };
+        string names;
+        vector<SnapshotRow> rows;
+        rows.reserve(index.size());
+        for (const ItemNode* item = head; item; item = item->next) {
+            SnapshotRow row{};
+            row.ID = item->ID;
+            row.quantity = item->quantity;
+            row.discount = item->discount;
+            row.demand = item->demand;
+            row.expiryDay = item->expiryDay;
+            row.buyCents = item->buyPrice.minorUnits();
+            row.listCents = item->listPrice.minorUnits();
+            row.nameOffset = (uint32_t)names.size();
+            row.nameLength = (uint32_t)item->name.size();
+            row.category = intern(item->category);
+            row.supplier = intern(item->supplierName);
+            row.categorized = catalog.find(item->ID) ? 1 : 0;
+            names += item->name;
+            rows.push_back(row);
+        }
+        out.put<uint64_t>(rows.size());
+        out.put<uint32_t>((uint32_t)strings.size());
+        for (const string* text : strings) out.putString(*text);
+        out.put<uint64_t>(names.size());
+        out.putBytes(names.data(), names.size());
+        out.putBytes(rows.data(), rows.size() * sizeof(SnapshotRow));
+        out.putString(promotionSeason);  // Trailing fields; older readers stop before them
+        out.putString(promotionCode);
+    }
+
+    // Re-apply a logged inventory mutation during recovery; returns false on a malformed record
+    bool applyLogRecord(WriteAheadLog::RecordType type, SnapshotReader& in) {
+        if (type == WriteAheadLog::SET_PROMOTION) {
+            string season, promoCode;
+            if (!in.getString(season) || !in.getString(promoCode)) return false;
+            setActivePromotion(season, promoCode);
+            return true;
+        }
+        int32_t ID;
+        if (!in.get(ID)) return false;
+        if (type == WriteAheadLog::REMOVE_PRODUCT) {
+            removeProduct(ID);
+            return true;
+        }
+        if (type == WriteAheadLog::CATEGORIZE_PRODUCT) {
+            categorizeProduct(ID);
+            return true;
+        }
+
+        int32_t quantity, discount, demand;
+        int64_t expiryDay;
+        Money sellPrice, buyPrice;
+        string name, category, supplierName;
+        if (!in.get(quantity) || !in.get(expiryDay) || !in.get(discount) || !in.get(demand) ||
+            !in.getMoney(sellPrice) || !in.getMoney(buyPrice) ||
+            !in.getString(name) || !in.getString(category) || !in.getString(supplierName)) {
+            return false;
+        }
+        if (type == WriteAheadLog::ADD_PRODUCT) {
+            insertProduct(ID, quantity, expiryDay, discount, sellPrice, buyPrice, name, category, supplierName, demand);
+        } else {
+            updateProduct(ID, name, category, quantity, expiryDay, discount, sellPrice, buyPrice, supplierName, demand);
+        }
+        return true;
+    }
+
+    // Rebuild the inventory from a snapshot section; returns false on truncated data.
+    // Every row is checked first, then the products are created and the ID index, columns,
+    // stock heaps and alerts are filled in bulk; the name and category indexes wait for
+    // the first search.
+    bool readSnapshot(SnapshotReader& in) {
+        uint64_t count, nameBytes;
+        uint32_t stringCount;
+        if (!in.get(count) || !in.get(stringCount)) return false;
+        vector<string> strings(stringCount);
+        for (string& text : strings) {
+            if (!in.getString(text)) return false;
+        }
+        const char* names;
+        const char* rows;
+        if (!in.get(nameBytes) || !in.getSpan(names, nameBytes) || count > in.remaining() / sizeof(SnapshotRow) ||
+            !in.getSpan(rows, count * sizeof(SnapshotRow))) {
+            return false;
+        }
+        for (uint64_t i = 0; i < count; i++) {
+            SnapshotRow row;
+            memcpy(&row, rows + i * sizeof(SnapshotRow), sizeof(row));
+            if ((uint64_t)row.nameOffset + row.nameLength > nameBytes || row.category >= stringCount || row.supplier >= stringCount) {
+                return false;
+            }
+        }
+        if (in.remaining() && (!in.getString(promotionSeason) || !in.getString(promotionCode))) return false;
+
+        reserveProducts(productCount() + count);
+        deferSecondaryIndexes();
+        unique_lock<shared_mutex> catalogGuard(catalogLock);
+        vector<uint32_t> columnIDs(stringCount);
+        for (uint32_t i = 0; i < stringCount; i++) columnIDs[i] = columns.intern(strings[i]);
+        vector<IndexedMinHeap::Entry> levels[STOCK_LOCK_STRIPES];
+        vector<const ItemNode*> loaded;
+        loaded.reserve(count);
+        for (uint64_t i = 0; i < count; i++) {
+            SnapshotRow row;
+            memcpy(&row, rows + i * sizeof(SnapshotRow), sizeof(row));
+            ItemNode* item = itemPool.create(row.ID, row.quantity, row.expiryDay, row.discount, Money::fromCents(row.listCents),
+                                             Money::fromCents(row.buyCents), string(names + row.nameOffset, row.nameLength),
+                                             strings[row.category], strings[row.supplier], row.demand);
+            if (!index.insert(item->ID, item)) {  // Duplicate ID
+                itemPool.destroy(item);
+                continue;
+            }
+            if (!head) {
+                head = tail = item;
+            } else {
+                tail->next = item;
+                item->prev = tail;
+                tail = item;
+            }
+            columns.append(item, columnIDs[row.category], columnIDs[row.supplier]);
+            levels[stockStripe(item->ID)].push_back({item->ID, item->quantity});
+            if (row.categorized) catalog.insert(item);
+            loaded.push_back(item);
+        }
+        for (size_t stripe = 0; stripe < STOCK_LOCK_STRIPES; stripe++) {
+            lock_guard<mutex> guard(stockLocks[stripe]);
+            stockLevels[stripe].insertAll(levels[stripe]);
+        }
+        alerts.trackAll(loaded);
+        return true;
+    }
+
+    // Find Product by ID
+    ItemNode* findProduct(int ID) const {
+        return index.find(ID);
+    }
+
+    // Update Product; expiryDay is absolute (see StockAlerts::today)
+    void updateProduct(int ID, string name, string category, int quantity = 0, int64_t expiryDay = 0, int discount = 0, Money sellPrice = Money(), Money buyPrice = Money(), string supplierName = "", int demand = 0) {
+        unique_lock<shared_mutex> catalogGuard(catalogLock);
+        ItemNode* current = index.find(ID);
+        if (!current) {
+            cout << "Product with ID " << ID << " not found.\n";
+            return;
+        }
+        if (current->name != name) {
+            unindexName(current);
+            current->name = name;
+            indexName(current);
+        }
+        if (current->category != category) {
+            unindexCategory(current);
+            current->category = category;
+            indexCategory(current);
+        }
+        if (quantity) current->quantity = quantity;
+        if (expiryDay) current->expiryDay = expiryDay;
+        if (discount) current->discount = discount;
+        if (!sellPrice.isZero()) current->listPrice = sellPrice;
+        if (!buyPrice.isZero()) current->buyPrice = buyPrice;
+        if (!supplierName.empty()) current->supplierName = supplierName;
+        if (demand) current->demand = demand;
+        // The new list price, category or demand goes through the promotion the way a pricing pass would
+        current->sellPrice = pricing.price(current->category, current->listPrice, current->demand);
+        if (demand && secondaryIndexesBuilt) searchEngine.demandChanged(ID);
+        columns.refresh(current);
+        trackStock(current);
+        alerts.stockChanged(current);
+        if (expiryDay) alerts.scheduleExpiry(current);
+
+        if (journal) {
+            SnapshotBuffer record;
+            record.put<int32_t>(ID);
+            record.put<int32_t>(quantity);
+            record.put<int64_t>(expiryDay);
+            record.put<int32_t>(discount);
+            record.put<int32_t>(demand);
+            record.putMoney(sellPrice);
+            record.putMoney(buyPrice);
+            record.putString(name);
+            record.putString(category);
+            record.putString(supplierName);
+            journal->append(WriteAheadLog::UPDATE_PRODUCT, record);
+            journal->commit();
+        }
+        cout << "Product updated successfully: " << name << endl;
+    }
+
+    // Remove Product
+    void removeProduct(int ID) {
+        unique_lock<shared_mutex> catalogGuard(catalogLock);
+        ItemNode* current = index.find(ID);
+        if (!current) {
+            cout << "Product with ID " << ID << " not found.\n";
+            return;
+        }
+        if (current->prev) {
+            current->prev->next = current->next;
+        } else {
+            head = current->next;
+        }
+        if (current->next) {
+            current->next->prev = current->prev;
+        } else {
+            tail = current->prev;
+        }
+        index.erase(ID);
+        catalog.erase(ID);
+        unindexName(current);
+        unindexCategory(current);
+        columns.remove(current);
+        {
+            size_t stripe = stockStripe(ID);
+            lock_guard<mutex> guard(stockLocks[stripe]);
+            stockLevels[stripe].erase(ID);
+        }
+        alerts.forget(ID);
+        itemPool.destroy(current);
+
+        if (journal) {
+            SnapshotBuffer record;
+            record.put<int32_t>(ID);
+            journal->append(WriteAheadLog::REMOVE_PRODUCT, record);
+            journal->commit();
+        }
+        cout << "Product removed successfully.\n";
+    }
+
+    // Categorize Product into the ordered product tree
+    void categorizeProduct(int ID) {
+        ItemNode* current = index.find(ID);
+        if (!current) {
+            cout << "Product with ID " << ID << " not found in inventory.\n";
+            return;
+        }
+        if (!catalog.insert(current)) {
+            cout << "Product already categorized: " << current->name << endl;
+            return;
+        }
+
+        if (journal) {
+            SnapshotBuffer record;
+            record.put<int32_t>(ID);
+            journal->append(WriteAheadLog::CATEGORIZE_PRODUCT, record);
+            journal->commit();
+        }
+        cout << "Product categorized successfully: " << current->name << endl;
+    }
+
+    // Search Product by Name, Category, or ID
+    // Reports every product matching any of the given criteria
+    void searchProduct(int ID = 0, string name = "", string category = "") {
+        int matches = 0;
+        ensureSecondaryIndexes();
+
+        if (ID) {
+            ItemNode* item = index.find(ID);
+            if (item) {
+                printProduct(item);
+                matches++;
+            }
+        }
+
+        if (!name.empty()) {
+            auto range = nameIndex.equal_range(name);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second == ID) continue;
+                printProduct(index.find(it->second));
+                matches++;
+            }
+        }
+
+        if (!category.empty()) {
+            auto entry = categoryIndex.find(category);
+            if (entry != categoryIndex.end()) {
+                for (int productID : entry->second) {
+                    ItemNode* item = index.find(productID);
+                    if (productID == ID || (!name.empty() && item->name == name)) continue;
+                    printProduct(item);
+                    matches++;
+                }
+            }
+        }
+
+        if (!matches) {
+            cout << "No matching products found.\n";
+        }
+    }
+
+    // Type-ahead Search: prefix matches first, then close spellings, by demand
+    void typeAheadSearch(const string& query, size_t limit = 10) {
+        ensureSecondaryIndexes();
+        vector<ItemNode*> results = searchEngine.prefixSearch(query, limit);
+        if (results.size() < limit) {
+            unordered_set<int> seen;
+            for (ItemNode* item : results) seen.insert(item->ID);
+            for (ItemNode* item : searchEngine.fuzzySearch(query, limit)) {
+                if (results.size() == limit) break;
+                if (seen.insert(item->ID).second) results.push_back(item);
+            }
+        }
+
+        if (results.empty()) {
+            cout << "No products match \"" << query << "\".\n";
+            return;
+        }
+        cout << "\n--- Suggestions for \"" << query << "\" ---\n";
+        for (ItemNode* item : results) {
+            cout << item->name << " (ID: " << item->ID << ", Category: " << item->category
+                 << ", Demand: " << item->demand << ")\n";
+        }
+    }
+
+    // Choose the season and promo code whose rules sell prices are derived with. List
+    // prices are left alone, so applying the same promotion again changes nothing.
+    void setActivePromotion(const string& season, const string& promoCode) {
+        promotionSeason = season;
+        promotionCode = promoCode;
+        if (journal) {
+            SnapshotBuffer record;
+            record.putString(season);
+            record.putString(promoCode);
+            journal->append(WriteAheadLog::SET_PROMOTION, record);
+            journal->commit();
+        }
+    }
+
+    const string& activeSeason() const { return promotionSeason; }
+    const string& activePromoCode() const { return promotionCode; }
+
+    // Set a product's demand from live sales figures (not journaled)
+    void setLiveDemand(int ID, int demand) {
+        ItemNode* item = index.find(ID);
+        if (!item || item->demand == demand) return;
+        item->demand = demand;
+        columns.refreshDemand(item);
+        if (secondaryIndexesBuilt) searchEngine.demandChanged(ID);
+    }
+
+    // Reprice the catalog from list prices and current demand (not journaled); returns how
+    // many prices changed. Checkouts may run concurrently: only sell prices are written.
+    // The table is kept for updateProduct, which must not overlap a pass.
+    size_t applyDynamicPricing(const PromotionTable& table) {
+        pricing = table;
+        vector<pair<ItemNode*, Money>> changed;
+        columns.evaluatePrices(table, changed);
+        for (const auto& entry : changed) {
+            entry.first->sellPrice = entry.second;
+            columns.refreshPrices(entry.first);
+        }
+        return changed.size();
+    }
+
+    // Search Categorized Products by ID Range
+    void searchProductRange(int lowID, int highID) {
+        if (catalog.empty()) {
+            cout << "No products categorized yet.\n";
+            return;
+        }
+
+        int matches = 0;
+        catalog.forEachInRange(lowID, highID, [&](ItemNode* item) {
+            printProduct(item);
+            matches++;
+        });
+        if (!matches) {
+            cout << "No products found with IDs between " << lowID << " and " << highID << ".\n";
+        }
+    }
+
+    // Generate Inventory Reports
+    void generateReport(int lowStockThreshold = 5, int expiryWindowDays = 7) {
+        if (!head) {
+            cout << "Inventory is empty.\n";
+            return;
+        }
+
+        ItemNode* current = head;
+        cout << "\n--- Inventory Report ---\n";
+        while (current) {
+            cout << "Product: " << current->name << ", Category: " << current->category
+                 << ", Quantity: " << current->quantity << ", Price: $" << current->sellPrice << endl;
+            current = current->next;
+        }
+
+        vector<pair<ItemNode*, int>> lowStock = stockBelow(lowStockThreshold);
+        if (!lowStock.empty()) {
+            cout << "\n--- Low Stock Alerts ---\n";
+            for (const auto& item : lowStock) {
+                cout << "Product: " << item.first->name << " has only " << item.second << " left in stock.\n";
+            }
+        }
+
+        cout << "\n--- Inventory Summary ---\n";
+        cout << "Total Stock Value: $" << columns.totalStockValue() << endl;
+        cout << "Products Expiring Within " << expiryWindowDays << " Days: " << columns.countExpiringBy(StockAlerts::today() + expiryWindowDays) << endl;
+        for (const auto& entry : columns.marginByCategory()) {
+            cout << "Category: " << entry.first << ", Margin on Stock: $" << entry.second << endl;
+        }
+    }
+};
+
+// Catalog Importer Class
+// Streams a supplier CSV/TSV file into the inventory. The file is mapped and split in place;
+// columns follow the Add Product prompt order:
+// ID, Name, Category, Buy Price, Sell Price, Quantity, Expire, Supplier Name, Discount, Demand
+class CatalogImporter {
+public:
+    struct Result {
+        size_t imported = 0;
+        size_t rejected = 0;
+    };
+
+private:
+    static constexpr size_t FIELD_COUNT = 10;
+    static constexpr size_t MAX_REPORTED_ERRORS = 20;
+
+    char delimiter;
+    size_t batchSize;
+
+    static string_view trim(string_view field) {
+        while (!field.empty() && (field.front() == ' ' || field.front() == '\r')) field.remove_prefix(1);
+        while (!field.empty() && (field.back() == ' ' || field.back() == '\r')) field.remove_suffix(1);
+        return field;
+    }
+
+    template <typename T>
+    static bool parseNumber(string_view field, T& value) {
+        field = trim(field);
+        if (!field.empty() && field.front() == '+') field.remove_prefix(1);
+        auto result = from_chars(field.data(), field.data() + field.size(), value);
+        return result.ec == errc() && result.ptr == field.data() + field.size();
+    }
+
+    static bool parseNumber(string_view field, Money& value) {
+        double amount;
+        if (!parseNumber(field, amount)) return false;
+        value = Money::fromDouble(amount);
+        return true;
+    }
+
+    // Split one line into fields. Quoted fields may contain the delimiter; doubled quotes
+    // inside them are unescaped into scratch, otherwise fields are views into the line.
+    bool splitLine(string_view line, vector<string_view>& fields, deque<string>& scratch) const {
+        fields.clear();
+        size_t pos = 0;
+        while (true) {
+            if (pos < line.size() && line[pos] == '"') {
+                string unquoted;
+                bool escaped = false;
+                size_t i = pos + 1;
+                for (; i < line.size(); i++) {
+                    if (line[i] != '"') continue;
+                    if (i + 1 < line.size() && line[i + 1] == '"') {
+                        escaped = true;
+                        i++;
+                        continue;
+                    }
+                    break;
+                }
+                if (i >= line.size()) return false;  // unterminated quote
+                string_view inner = line.substr(pos + 1, i - pos - 1);
+                if (escaped) {
+                    for (size_t j = 0; j < inner.size(); j++) {
+                        unquoted += inner[j];
+                        if (inner[j] == '"') j++;
+                    }
+                    scratch.push_back(move(unquoted));
+                    inner = scratch.back();
+                }
+                fields.push_back(inner);
+                pos = i + 1;
+                if (pos < line.size() && line[pos] != delimiter && line[pos] != '\r') return false;
+            } else {
+                size_t end = line.find(delimiter, pos);
+                fields.push_back(trim(line.substr(pos, end == string_view::npos ? string_view::npos : end - pos)));
+                pos = end == string_view::npos ? line.size() : end;
+            }
+            if (pos >= line.size() || line[pos] != delimiter) return true;
+            pos++;
+        }
+    }
+
+    static void reportError(Result& result, size_t lineNumber, const string& reason) {
+        result.rejected++;
+        if (result.rejected <= MAX_REPORTED_ERRORS) {
+            cout << "Line " << lineNumber << ": " << reason << "\n";
+        } else if (result.rejected == MAX_REPORTED_ERRORS + 1) {
+            cout << "Further malformed rows are counted but not listed.\n";
+        }
+    }
+
+public:
+    CatalogImporter(size_t batchSize = 65536) : delimiter(','), batchSize(max<size_t>(1, batchSize)) {}
+
+    // Import every well-formed row; malformed or duplicate rows are reported and skipped.
+    // A first line whose ID column is not a number is treated as a header.
+    Result importFile(const string& path, InventoryManagement& inventory) {
+        MappedFile file;
+        if (!file.open(path)) {
+            cout << "Could not open catalog file: " << path << "\n";
+            return Result();
+        }
+        return importData(string_view(file.data(), file.size()), inventory);
+    }
+
+    // Same, for file contents already in memory
+    Result importData(string_view data, InventoryManagement& inventory) {
+        Result result;
+        size_t firstLineEnd = data.find('\n');
+        delimiter = data.substr(0, firstLineEnd).find('\t') != string_view::npos ? '\t' : ',';
+
+        // One row per line, so the line count bounds the storage needed
+        size_t lineCount = (size_t)count(data.begin(), data.end(), '\n') + 1;
+        if (inventory.productCount() == 0 || lineCount > inventory.productCount()) {
+            inventory.deferSecondaryIndexes();
+        }
+        inventory.reserveProducts(inventory.productCount() + lineCount);
+
+        vector<string_view> fields;
+        deque<string> scratch;  // stable addresses for unescaped fields
+        size_t lineNumber = 0, inBatch = 0;
+        int64_t today = StockAlerts::today();
+        size_t pos = 0;
+        while (pos < data.size()) {
+            size_t end = data.find('\n', pos);
+            if (end == string_view::npos) end = data.size();
+            string_view line = data.substr(pos, end - pos);
+            pos = end + 1;
+            lineNumber++;
+
+            if (trim(line).empty()) continue;
+            scratch.clear();
+            if (!splitLine(line, fields, scratch)) {
+                reportError(result, lineNumber, "unterminated or misplaced quote");
+                continue;
+            }
+
+            int ID, quantity, expire, discount, demand;
+            Money buyPrice, sellPrice;
+            if (!parseNumber(fields[0], ID)) {
+                if (lineNumber == 1) continue;  // header row
+                reportError(result, lineNumber, "invalid ID \"" + string(fields[0]) + "\"");
+                continue;
+            }
+            if (fields.size() != FIELD_COUNT) {
+                reportError(result, lineNumber, "expected " + to_string(FIELD_COUNT) + " fields, found " + to_string(fields.size()));
+                continue;
+            }
+            if (!parseNumber(fields[3], buyPrice) || !parseNumber(fields[4], sellPrice) ||
+                !parseNumber(fields[5], quantity) || !parseNumber(fields[6], expire) ||
+                !parseNumber(fields[8], discount) || !parseNumber(fields[9], demand)) {
+                reportError(result, lineNumber, "invalid numeric field");
+                continue;
+            }
+            if (quantity < 0) {
+                reportError(result, lineNumber, "negative quantity " + to_string(quantity));
+                continue;
+            }
+            if (buyPrice < Money() || sellPrice < Money()) {
+                reportError(result, lineNumber, "negative buy or sell price");
+                continue;
+            }
+            if (fields[1].empty()) {
+                reportError(result, lineNumber, "missing product name");
+                continue;
+            }
+            if (!inventory.insertProduct(ID, quantity, today + expire, discount, sellPrice, buyPrice,
+                                         string(fields[1]), string(fields[2]), string(fields[7]), demand)) {
+                reportError(result, lineNumber, "duplicate product ID " + to_string(ID));
+                continue;
+            }
+            result.imported++;
+            if (++inBatch == batchSize) {
+                inventory.commitLog();
+                inBatch = 0;
+            }
+        }
+        inventory.commitLog();
+        return result;
+    }
+};
+
+// Query Pool Class
+// Fixed set of worker threads for scatter/gather work. run() spreads tasks 0..count-1 over
+// the workers and the calling thread and returns once every task has finished. One job
+// runs at a time; concurrent callers queue on runLock.
+class QueryPool {
+private:
+    vector<thread> workers;
+    mutex runLock;
+    mutex lock;
+    condition_variable wake;
+    condition_variable finished;
+    const function<void(size_t)>* job;  // Current job, nullptr between jobs
+    size_t jobSize;
+    atomic<size_t> nextTask;
+    atomic<size_t> doneTasks;
+    size_t activeWorkers;
+    uint64_t generation;
+    bool stopping;
+
+    void drain(const function<void(size_t)>& task, size_t count) {
+        for (size_t i; (i = nextTask++) < count; doneTasks++) task(i);
+    }
+
+    void work() {
+        uint64_t seen = 0;
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            wake.wait(guard, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+            if (!job) continue;
+            const function<void(size_t)>* task = job;
+            size_t count = jobSize;
+            activeWorkers++;
+            guard.unlock();
+            drain(*task, count);
+            guard.lock();
+            if (--activeWorkers == 0) finished.notify_all();
+        }
+    }
+
+public:
+    explicit QueryPool(size_t threads = thread::hardware_concurrency())
+        : job(nullptr), jobSize(0), nextTask(0), doneTasks(0), activeWorkers(0), generation(0), stopping(false) {
+        size_t helpers = max<size_t>(1, threads) - 1;  // The caller is the last thread
+        for (size_t i = 0; i < helpers; i++) workers.emplace_back(&QueryPool::work, this);
+    }
+
+    ~QueryPool() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (thread& worker : workers) worker.join();
+    }
+
+    QueryPool(const QueryPool&) = delete;
+    QueryPool& operator=(const QueryPool&) = delete;
+
+    size_t threadCount() const { return workers.size() + 1; }
+
+    void run(size_t count, const function<void(size_t)>& task) {
+        if (count == 0) return;
+        lock_guard<mutex> running(runLock);
+        {
+            lock_guard<mutex> guard(lock);
+            job = &task;
+            jobSize = count;
+            nextTask = 0;
+            doneTasks = 0;
+            generation++;
+        }
+        wake.notify_all();
+        drain(task, count);
+        unique_lock<mutex> guard(lock);
+        finished.wait(guard, [&] { return doneTasks.load() == count && activeWorkers == 0; });
+        job = nullptr;
+    }
+};
+
+// Store Network Class
+// Chain-wide view over one inventory per store. Chain queries scatter one task per store
+// over a QueryPool and merge the partial results. Each task reads through the store's
+// own catalog and stock locks, so it stays consistent with that store's admin changes
+// and checkouts. Stores must not be added while a query runs.
+class StoreNetwork {
+public:
+    struct CategoryTotals {
+        int64_t units = 0;
+        Money stockValue;
+        size_t products = 0;
+        size_t stores = 0;  // Stores carrying the category
+    };
+
+private:
+    struct Store {
+        int storeID;
+        InventoryManagement* inventory;
+        unique_ptr<InventoryManagement> owned;
+    };
+
+    vector<unique_ptr<Store>> stores;
+    unordered_map<int, size_t> storeByID;
+    QueryPool pool;
+
+    Store* insertStore(int storeID, InventoryManagement* inventory) {
+        if (!storeByID.emplace(storeID, stores.size()).second) return nullptr;
+        stores.emplace_back(new Store{storeID, inventory, nullptr});
+        return stores.back().get();
+    }
+
+public:
+    explicit StoreNetwork(size_t threads = thread::hardware_concurrency()) : pool(threads) {}
+
+    StoreNetwork(const StoreNetwork&) = delete;
+    StoreNetwork& operator=(const StoreNetwork&) = delete;
+
+    // Open an empty store owned by the network; returns nullptr if the ID is taken
+    InventoryManagement* addStore(int storeID) {
+        unique_ptr<InventoryManagement> inventory(new InventoryManagement());
+        Store* store = insertStore(storeID, inventory.get());
+        if (!store) return nullptr;
+        store->owned = std::move(inventory);
+        return store->inventory;
+    }
+
+    // Include an inventory owned elsewhere (such as this process's own store)
+    bool attachStore(int storeID, InventoryManagement* inventory) {
+        return insertStore(storeID, inventory) != nullptr;
+    }
+
+    size_t storeCount() const { return stores.size(); }
+    size_t threadCount() const { return pool.threadCount(); }
+
+    // Quantity of a product in every store that carries it
+    vector<pair<int, int>> stockByStore(int productID) {
+        vector<int> quantities(stores.size(), -1);
+        pool.run(stores.size(), [&](size_t i) { quantities[i] = stores[i]->inventory->stockOf(productID); });
+        vector<pair<int, int>> result;
+        for (size_t i = 0; i < stores.size(); i++) {
+            if (quantities[i] >= 0) result.push_back({stores[i]->storeID, quantities[i]});
+        }
+        return result;
+    }
+
+    // Units of a product on hand across the chain
+    int64_t totalStock(int productID) {
+        int64_t total = 0;
+        for (const auto& entry : stockByStore(productID)) total += entry.second;
+        return total;
+    }
+
+    // Stock on hand per category across the chain
+    map<string, CategoryTotals> categoryReport() {
+        vector<map<string, InventoryColumns::CategoryStock>> partial(stores.size());
+        pool.run(stores.size(), [&](size_t i) { partial[i] = stores[i]->inventory->stockByCategory(); });
+        map<string, CategoryTotals> report;
+        for (const auto& storeTotals : partial) {
+            for (const auto& entry : storeTotals) {
+                CategoryTotals& totals = report[entry.first];
+                totals.units += entry.second.units;
+                totals.stockValue += entry.second.stockValue;
+                totals.products += entry.second.products;
+                totals.stores++;
+            }
+        }
+        return report;
+    }
+};
+
+// Demand Tracker Class
+// Live sales rates per product. Checkout threads record sales into their own
+// single-producer ring (no locks, no shared cache lines); merge() drains the rings into
+// exponentially decayed counters, one per window, so recent sales weigh most.
+class DemandTracker {
+public:
+    enum Window { SHORT_WINDOW, HOUR_WINDOW, DAY_WINDOW, WINDOW_COUNT };
+
+private:
+    // Single-producer, single-consumer queue of (product ID, units) sales
+    struct SalesRing {
+        static constexpr size_t CAPACITY = 4096;
+        pair<int, int> sales[CAPACITY];
+        alignas(64) atomic<size_t> head{0};  // Next write, owned by the recording thread
+        alignas(64) atomic<size_t> tail{0};  // Next read, owned by merge()
+
+        bool push(int productID, int units) {
+            size_t position = head.load(memory_order_relaxed);
+            if (position - tail.load(memory_order_acquire) == CAPACITY) return false;
+            sales[position % CAPACITY] = {productID, units};
+            head.store(position + 1, memory_order_release);
+            return true;
+        }
+
+        template <typename Visitor>
+        void drain(Visitor visit) {
+            size_t position = tail.load(memory_order_relaxed);
+            size_t end = head.load(memory_order_acquire);
+            for (; position != end; position++) visit(sales[position % CAPACITY]);
+            tail.store(position, memory_order_release);
+        }
+    };
+
+    struct Rates {
+        double decayed[WINDOW_COUNT];  // Units, each decayed with its window's time constant
+        double lastUpdate;             // Seconds since the tracker started
+    };
+
+    static constexpr double WINDOW_SECONDS[WINDOW_COUNT] = {300, 3600, 86400};
+
+    const uint64_t trackerID;
+    chrono::steady_clock::time_point started;
+    mutex ringsLock;
+    vector<unique_ptr<SalesRing>> rings;
+    mutex overflowLock;                  // Sales that found their ring full
+    vector<pair<int, int>> overflow;
+    mutable mutex statsLock;
+    unordered_map<int, Rates> stats;
+
+    static uint64_t nextTrackerID() {
+        static atomic<uint64_t> counter{1};
+        return counter++;
+    }
+
+    SalesRing& localRing() {
+        // Per thread: the ring this thread owns in each tracker it has recorded into
+        thread_local vector<pair<uint64_t, SalesRing*>> owned;
+        for (const auto& entry : owned) {
+            if (entry.first == trackerID) return *entry.second;
+        }
+        lock_guard<mutex> guard(ringsLock);
+        rings.push_back(unique_ptr<SalesRing>(new SalesRing()));
+        owned.push_back({trackerID, rings.back().get()});
+        return *rings.back();
+    }
+
+    double elapsedSeconds() const {
+        return chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    }
+
+    static void decayTo(Rates& rates, double now) {
+        double age = now - rates.lastUpdate;
+        if (age <= 0) return;
+        for (int w = 0; w < WINDOW_COUNT; w++) rates.decayed[w] *= exp(-age / WINDOW_SECONDS[w]);
+        rates.lastUpdate = now;
+    }
+
+    void addSale(int productID, int units, double now) {
+        auto found = stats.find(productID);
+        if (found == stats.end()) found = stats.emplace(productID, Rates{{0, 0, 0}, now}).first;
+        decayTo(found->second, now);
+        for (int w = 0; w < WINDOW_COUNT; w++) found->second.decayed[w] += units;
+    }
+
+public:
+    DemandTracker() : trackerID(nextTrackerID()), started(chrono::steady_clock::now()) {}
+
+    DemandTracker(const DemandTracker&) = delete;
+    DemandTracker& operator=(const DemandTracker&) = delete;
+
+    // Record units sold; lock-free unless this thread's ring is full
+    void recordSale(int productID, int units) {
+        if (localRing().push(productID, units)) return;
+        lock_guard<mutex> guard(overflowLock);
+        overflow.push_back({productID, units});
+    }
+
+    // Fold recorded sales into the decayed rates
+    void merge() {
+        double now = elapsedSeconds();
+        vector<SalesRing*> snapshot;
+        {
+            lock_guard<mutex> guard(ringsLock);
+            for (const auto& ring : rings) snapshot.push_back(ring.get());
+        }
+        vector<pair<int, int>> spilled;
+        {
+            lock_guard<mutex> guard(overflowLock);
+            spilled.swap(overflow);
+        }
+        lock_guard<mutex> guard(statsLock);
+        for (SalesRing* ring : snapshot) {
+            ring->drain([&](const pair<int, int>& sale) { addSale(sale.first, sale.second, now); });
+        }
+        for (const auto& sale : spilled) addSale(sale.first, sale.second, now);
+    }
+
+    size_t trackedProducts() const {
+        lock_guard<mutex> guard(statsLock);
+        return stats.size();
+    }
+
+    // Units per hour over the window, as of the last merge
+    double ratePerHour(int productID, Window window = HOUR_WINDOW) const {
+        lock_guard<mutex> guard(statsLock);
+        auto found = stats.find(productID);
+        if (found == stats.end()) return 0.0;
+        Rates rates = found->second;
+        decayTo(rates, elapsedSeconds());
+        return rates.decayed[window] / WINDOW_SECONDS[window] * 3600;
+    }
+
+    // Visit the rate of every product that has sold since tracking began
+    void forEachRate(Window window, const function<void(int productID, double perHour)>& visit) const {
+        lock_guard<mutex> guard(statsLock);
+        double now = elapsedSeconds();
+        for (const auto& entry : stats) {
+            Rates rates = entry.second;
+            decayTo(rates, now);
+            visit(entry.first, rates.decayed[window] / WINDOW_SECONDS[window] * 3600);
+        }
     }
 };
 
-class InventoryManagement {
+// Cart Pricing Class
+// Incremental pricing engine. Line subtotals and line discounts are running sums; the
+// promotion (a rate on the discounted subtotal) and tax are derived from them in O(1),
+// so display, checkout and recovery all arrive at the same exact figures.
+class CartPricing {
 private:
-    ItemNode* head;
-    ItemNode* tail;
-    ItemNode* root;
+    Money subtotalAmount;
+    Money lineDiscountAmount;
+    int64_t promotionBasisPoints;
+    int64_t taxBasisPoints;
 
 public:
-    // Constructor
-    InventoryManagement() : head(nullptr), tail(nullptr), root(nullptr) {}
+    static int64_t toBasisPoints(double rate) { return llround(rate * 10000); }
 
-    // Add Product
-    void addProduct(int ID, int quantity, int expire, int discount, double sellPrice, double buyPrice, string name, string category, string supplierName, int demand) {
-        ItemNode* newItem = new ItemNode(ID, quantity, expire, discount, sellPrice, buyPrice, name, category, supplierName, demand);
-        if (!head) {
-            head = tail = newItem;
-        } else {
-            tail->next = newItem;
-            tail = newItem;
-        }
-        cout << "Product added successfully: " << name << endl;
+    static Money lineSubtotal(const CartItem& item) { return item.price * item.quantity; }
+    // CartItem::discount is a percentage
+    static Money lineDiscount(const CartItem& item) { return lineSubtotal(item).applyRate(llround(item.discount * 100)); }
+    static Money lineTotal(const CartItem& item) { return lineSubtotal(item) - lineDiscount(item); }
+
+    CartPricing(double taxRate = 0.1) : promotionBasisPoints(0), taxBasisPoints(toBasisPoints(taxRate)) {}
+
+    void addLine(const CartItem& item) {
+        subtotalAmount += lineSubtotal(item);
+        lineDiscountAmount += lineDiscount(item);
     }
 
-    // Update Product
-    void updateProduct(int ID, string name, string category, int quantity = 0, int expire = 0, int discount = 0, double sellPrice = 0, double buyPrice = 0, string supplierName = "", int demand = 0) {
-        ItemNode* current = head;
-        while (current) {
-            if (current->ID == ID) {
-                current->name = name;
-                current->category = category;
-                if (quantity) current->quantity = quantity;
-                if (expire) current->expire = expire;
-                if (discount) current->discount = discount;
-                if (sellPrice) current->sellPrice = sellPrice;
-                if (buyPrice) current->buyPrice = buyPrice;
-                if (!supplierName.empty()) current->supplierName = supplierName;
-                if (demand) current->demand = demand;
-                cout << "Product updated successfully: " << name << endl;
-                return;
-            }
-            current = current->next;
+    void removeLine(const CartItem& item) {
+        subtotalAmount -= lineSubtotal(item);
+        lineDiscountAmount -= lineDiscount(item);
+    }
+
+    // Fractional rates, e.g. 0.10 for 10%
+    void setPromotionRate(double rate) { promotionBasisPoints = toBasisPoints(rate); }
+    void setTaxRate(double rate) { taxBasisPoints = toBasisPoints(rate); }
+
+    // Drop all lines and the promotion; the tax rate stays
+    void reset() {
+        subtotalAmount = lineDiscountAmount = Money();
+        promotionBasisPoints = 0;
+    }
+
+    Money subtotal() const { return subtotalAmount; }
+    Money lineDiscounts() const { return lineDiscountAmount; }
+    Money promotion() const { return (subtotalAmount - lineDiscountAmount).applyRate(promotionBasisPoints); }
+    Money tax() const { return (subtotalAmount - lineDiscountAmount - promotion()).applyRate(taxBasisPoints); }
+    Money total() const { return subtotalAmount - lineDiscountAmount - promotion() + tax(); }
+
+    // Print the cart's price breakdown
+    void display() const {
+        cout << "Subtotal: $" << subtotalAmount << "\n";
+        if (!lineDiscountAmount.isZero()) cout << "Discounts: -$" << lineDiscountAmount << "\n";
+        if (promotionBasisPoints) cout << "Promotion: -$" << promotion() << "\n";
+        cout << "Tax: $" << tax() << "\n";
+        cout << "Total Price: $" << total() << "\n";
+    }
+};
+
+// Shopping Cart Class
+// Lines live contiguously with an ID -> slot map, so scanning an item already in the cart
+// merges into its line and quantity changes are O(1). Line slots only change at the end
+// of the array, which lets the undo/redo command log address lines by slot. Totals are
+// maintained incrementally by the pricing engine.
+class ShoppingCart {
+private:
+    enum CommandType { ADD_LINE, REMOVE_LINE, SET_QUANTITY };
+
+    struct CartCommand {
+        CommandType type;
+        size_t slot;        // Affected line (SET_QUANTITY)
+        int oldQuantity;
+        int newQuantity;
+        CartItem line;      // Line while it is out of the cart (ADD_LINE/REMOVE_LINE)
+    };
+
+    SmallVector<CartItem, 16> lines;
+    unordered_map<int, size_t> slotByID;
+    CartPricing pricing;
+    string appliedPromoCode;
+
+    deque<CartCommand> undoLog;  // Oldest command at the front
+    vector<CartCommand> redoLog;
+    size_t historyDepth;
+
+    void pushLine(CartItem&& item) {
+        pricing.addLine(item);
+        slotByID[item.ID] = lines.size();
+        lines.push_back(std::move(item));
+    }
+
+    CartItem popLine() {
+        CartItem item = std::move(lines.back());
+        lines.pop_back();
+        slotByID.erase(item.ID);
+        pricing.removeLine(item);
+        return item;
+    }
+
+    void setQuantity(size_t slot, int quantity) {
+        CartItem& item = lines[slot];
+        pricing.removeLine(item);
+        item.quantity = quantity;
+        pricing.addLine(item);
+    }
+
+    void record(CartCommand&& command) {
+        redoLog.clear();
+        undoLog.push_back(std::move(command));
+        if (undoLog.size() > historyDepth) undoLog.pop_front();
+    }
+
+    // Apply command in reverse (undo == true) or forward again (redo)
+    void apply(CartCommand& command, bool undo) {
+        bool takeOut = (command.type == ADD_LINE) == undo;
+        switch (command.type) {
+            case ADD_LINE:
+            case REMOVE_LINE:
+                if (takeOut) command.line = popLine();
+                else pushLine(std::move(command.line));
+                break;
+            case SET_QUANTITY:
+                setQuantity(command.slot, undo ? command.oldQuantity : command.newQuantity);
+                break;
         }
-        cout << "Product with ID " << ID << " not found.\n";
     }
 
-    // Remove Product
-    void removeProduct(int ID) {
-        ItemNode* current = head;
-        ItemNode* prev = nullptr;
-        while (current) {
-            if (current->ID == ID) {
-                if (prev) {
-                    prev->next = current->next;
-                } else {
-                    head = current->next;
-                }
-                if (current == tail) {
-                    tail = prev;
-                }
-                delete current;
-                cout << "Product removed successfully.\n";
-                return;
-            }
-            prev = current;
-            current = current->next;
+    static CartCommand lineCommand(CommandType type, CartItem&& line) {
+        return CartCommand{type, 0, 0, 0, std::move(line)};
+    }
+
+    static CartCommand quantityCommand(size_t slot, int oldQuantity, int newQuantity) {
+        return CartCommand{SET_QUANTITY, slot, oldQuantity, newQuantity, CartItem(0, "", Money(), 0, 0)};
+    }
+
+public:
+    ShoppingCart(size_t historyDepth = 100) : historyDepth(historyDepth) {}
+
+    const CartItem* begin() const { return lines.begin(); }
+    const CartItem* end() const { return lines.end(); }
+    size_t size() const { return lines.size(); }
+    bool empty() const { return lines.empty(); }
+    const CartPricing& totals() const { return pricing; }
+
+    // Line holding a product ID, or nullptr if it is not in the cart
+    const CartItem* findLine(int ID) const {
+        auto found = slotByID.find(ID);
+        return found == slotByID.end() ? nullptr : &lines[found->second];
+    }
+
+    // Order-level promotion, e.g. 0.10 for 10% off, from a promo code (cleared with the cart)
+    void setPromotion(const string& code, double rate) {
+        appliedPromoCode = code;
+        pricing.setPromotionRate(rate);
+    }
+    const string& promoCode() const { return appliedPromoCode; }
+    void setTaxRate(double rate) { pricing.setTaxRate(rate); }
+
+    // Limit how many actions can be undone
+    void setHistoryDepth(size_t depth) {
+        historyDepth = depth;
+        while (undoLog.size() > historyDepth) undoLog.pop_front();
+    }
+
+    // Empty the cart and forget its undo/redo history
+    void clear() {
+        lines.clear();
+        slotByID.clear();
+        pricing.reset();
+        appliedPromoCode.clear();
+        undoLog.clear();
+        redoLog.clear();
+    }
+
+    // Add Item to Cart (an ID already in the cart merges into its line)
+    void addItem(int ID, string name, Money price, int quantity, double discount) {
+        if (quantity <= 0) {
+            cout << "Invalid quantity: " << quantity << ". Quantity must be at least 1.\n";
+            return;
+        }
+        auto found = slotByID.find(ID);
+        if (found != slotByID.end()) {
+            size_t slot = found->second;
+            int oldQuantity = lines[slot].quantity;
+            setQuantity(slot, oldQuantity + quantity);
+            record(quantityCommand(slot, oldQuantity, oldQuantity + quantity));
+        } else {
+            pushLine(CartItem(ID, name, price, quantity, discount));
+            record(lineCommand(ADD_LINE, CartItem(0, "", Money(), 0, 0)));
         }
-        cout << "Product with ID " << ID << " not found.\n";
+        cout << "Item added to cart: " << name << " (Quantity: " << quantity << ")\n";
     }
 
-    // Categorize Product into BST
-    void categorizeProduct(int ID) {
-        ItemNode* current = head;
-        while (current) {
-            if (current->ID == ID) {
-                root = insertToBST(root, current);
-                cout << "Product categorized successfully: " << current->name << endl;
-                return;
-            }
-            current = current->next;
+    // Remove Last Added Item
+    void removeLastItem() {
+        if (!lines.empty()) {
+            record(lineCommand(REMOVE_LINE, popLine()));
+            cout << "Last item removed from cart.\n";
+        } else {
+            cout << "Cart is empty. Nothing to remove.\n";
         }
-        cout << "Product with ID " << ID << " not found in inventory.\n";
     }
 
-    ItemNode* insertToBST(ItemNode* node, ItemNode* product) {
-        if (!node) return new ItemNode(*product);
-        if (product->ID < node->ID) {
-            node->left = insertToBST(node->left, product);
+    // Undo Last Operation
+    void undoLastAction() {
+        if (!undoLog.empty()) {
+            apply(undoLog.back(), true);
+            redoLog.push_back(std::move(undoLog.back()));
+            undoLog.pop_back();
+            cout << "Undo successful. Current cart size: " << lines.size() << endl;
         } else {
-            node->right = insertToBST(node->right, product);
+            cout << "No actions to undo.\n";
         }
-        return node;
     }
 
-    // Search Product by Name, Category, or ID
-    void searchProduct(int ID = 0, string name = "", string category = "") {
-        if (root) {
-            searchInBST(root, ID, name, category);
+    // Redo Last Undone Operation
+    void redoLastAction() {
+        if (!redoLog.empty()) {
+            apply(redoLog.back(), false);
+            undoLog.push_back(std::move(redoLog.back()));
+            redoLog.pop_back();
+            cout << "Redo successful. Current cart size: " << lines.size() << endl;
         } else {
-            cout << "No products categorized yet.\n";
+            cout << "No actions to redo.\n";
         }
     }
 
-    void searchInBST(ItemNode* node, int ID, string name, string category) {
-        if (!node) return;
+    // Update Quantity of an Existing Item
+    void updateQuantity(int ID, int newQuantity) {
+        if (newQuantity <= 0) {
+            cout << "Invalid quantity: " << newQuantity << ". Quantity must be at least 1.\n";
+            return;
+        }
+        auto found = slotByID.find(ID);
+        if (found == slotByID.end()) {
+            cout << "Item with ID " << ID << " not found in cart.\n";
+            return;
+        }
+        size_t slot = found->second;
+        int oldQuantity = lines[slot].quantity;
+        setQuantity(slot, newQuantity);
+        record(quantityCommand(slot, oldQuantity, newQuantity));
+        cout << "Quantity updated for item: " << lines[slot].name << " (New Quantity: " << newQuantity << ")\n";
+    }
 
-        if ((ID && node->ID == ID) || (!name.empty() && node->name == name) || (!category.empty() && node->category == category)) {
-            cout << "Product found: " << node->name << " (" << node->category << ")" << endl;
-            cout << "ID: " << node->ID << ", Price: $" << node->sellPrice << ", Quantity: " << node->quantity << endl;
+    // Display Cart Summary
+    void displayCart() {
+        if (lines.empty()) {
+            cout << "Cart is empty.\n";
             return;
         }
 
-        if (ID && ID < node->ID) {
-            searchInBST(node->left, ID, name, category);
-        } else {
-            searchInBST(node->right, ID, name, category);
+        cout << "\n--- Cart Summary ---\n";
+        for (const auto& item : lines) {
+            cout << "Item: " << item.name
+                 << ", Quantity: " << item.quantity
+                 << ", Price: $" << item.price
+                 << ", Subtotal: $" << CartPricing::lineTotal(item)
+                 << " (Discount: " << item.discount << "%)\n";
         }
+        pricing.display();
     }
+};
 
-    // Generate Inventory Reports
-    void generateReport() {
-        if (!head) {
-            cout << "Inventory is empty.\n";
-            return;
+// Order Class
+class Order {
+public:
+    int orderID;
+    vector<CartItem> itemList;
+    Money totalPrice;
+    unsigned lane;  // Checkout lane that placed the order
+    chrono::steady_clock::time_point placedAt;
+
+    Order() : orderID(0), lane(0), placedAt(chrono::steady_clock::now()) {}
+
+    Order(int orderID, vector<CartItem> itemList, Money totalPrice, unsigned lane = 0)
+        : orderID(orderID), itemList(std::move(itemList)), totalPrice(totalPrice), lane(lane),
+          placedAt(chrono::steady_clock::now()) {}
+};
+
+// Sharded Order Queue Class
+// Pending orders spread over independently locked shards kept in ID order (one per group of lanes),
+// so concurrent checkout lanes rarely contend. Each shard pools its own order records.
+class ShardedOrderQueue {
+private:
+    struct Shard {
+        mutex lock;
+        deque<Order*> orders;
+        ObjectPool<Order, 256> pool;
+    };
+
+    size_t shardCount;
+    unique_ptr<Shard[]> shards;
+    atomic<size_t> pending;
+
+    Shard& shardFor(unsigned lane) { return shards[lane % shardCount]; }
+
+public:
+    ShardedOrderQueue(size_t shardCount = 32)
+        : shardCount(max<size_t>(1, shardCount)), shards(new Shard[max<size_t>(1, shardCount)]), pending(0) {}
+
+    ~ShardedOrderQueue() {
+        for (size_t i = 0; i < shardCount; i++) {
+            for (Order* order : shards[i].orders) shards[i].pool.destroy(order);
         }
+    }
 
-        ItemNode* current = head;
-        priority_queue<pair<int, string>> lowStockQueue;
+    ShardedOrderQueue(const ShardedOrderQueue&) = delete;
+    ShardedOrderQueue& operator=(const ShardedOrderQueue&) = delete;
 
-        cout << "\n--- Inventory Report ---\n";
-        while (current) {
-            cout << "Product: " << current->name << ", Category: " << current->category
-                 << ", Quantity: " << current->quantity << ", Price: $" << current->sellPrice << endl;
-            if (current->quantity < 5) {
-                lowStockQueue.push({current->quantity, current->name});
+    size_t size() const { return pending.load(); }
+    bool empty() const { return size() == 0; }
+
+    // Lanes sharing a shard take IDs and push in separate steps, so an order can arrive
+    // after a newer one; it is inserted in ID order (near the back) to keep heads oldest
+    void push(int orderID, vector<CartItem> itemList, Money totalPrice, unsigned lane) {
+        Shard& shard = shardFor(lane);
+        lock_guard<mutex> guard(shard.lock);
+        auto position = shard.orders.end();
+        while (position != shard.orders.begin() && (*prev(position))->orderID > orderID) --position;
+        shard.orders.insert(position, shard.pool.create(orderID, std::move(itemList), totalPrice, lane));
+        pending++;
+    }
+
+    // Remove the oldest pending order (each shard is sorted by ID, so the lowest ID among
+    // the shard heads) and hand it to the visitor before its record is recycled. Returns false if nothing is pending.
+    // The visitor runs with the shard locked, so it must not block (copy the order out).
+    template <typename Visitor>
+    bool popOldest(Visitor visit) {
+        while (!empty()) {
+            size_t best = shardCount;
+            int bestID = INT_MAX;
+            for (size_t i = 0; i < shardCount; i++) {
+                lock_guard<mutex> guard(shards[i].lock);
+                if (!shards[i].orders.empty() && shards[i].orders.front()->orderID < bestID) {
+                    bestID = shards[i].orders.front()->orderID;
+                    best = i;
+                }
             }
-            current = current->next;
+            if (best == shardCount) return false;
+
+            Shard& shard = shards[best];
+            lock_guard<mutex> guard(shard.lock);
+            if (shard.orders.empty() || shard.orders.front()->orderID != bestID) continue;  // raced, retry
+            Order* order = shard.orders.front();
+            shard.orders.pop_front();
+            pending--;
+            visit(*order);
+            shard.pool.destroy(order);
+            return true;
         }
+        return false;
+    }
 
-        if (!lowStockQueue.empty()) {
-            cout << "\n--- Low Stock Alerts ---\n";
-            while (!lowStockQueue.empty()) {
-                auto item = lowStockQueue.top();
-                lowStockQueue.pop();
-                cout << "Product: " << item.second << " has only " << item.first << " left in stock.\n";
+    // Remove a specific pending order; used when replaying the journal
+    bool remove(int orderID) {
+        for (size_t i = 0; i < shardCount; i++) {
+            lock_guard<mutex> guard(shards[i].lock);
+            auto& orders = shards[i].orders;
+            for (auto it = orders.begin(); it != orders.end(); ++it) {
+                if ((*it)->orderID == orderID) {
+                    shards[i].pool.destroy(*it);
+                    orders.erase(it);
+                    pending--;
+                    return true;
+                }
             }
         }
+        return false;
+    }
+
+    // Visit every pending order, oldest first. The orders are copied while their shard is
+    // locked, since lanes and fulfillment may recycle the records as soon as it is released.
+    template <typename Visitor>
+    void forEachPending(Visitor visit) {
+        vector<Order> orders;
+        orders.reserve(size());
+        for (size_t i = 0; i < shardCount; i++) {
+            lock_guard<mutex> guard(shards[i].lock);
+            for (const Order* order : shards[i].orders) orders.push_back(*order);
+        }
+        sort(orders.begin(), orders.end(), [](const Order& a, const Order& b) { return a.orderID < b.orderID; });
+        for (const Order& order : orders) visit(order);
     }
 };
 
-// Cart Item Class
-class CartItem {
+// Best Seller Sketch Class
+// Space-Saving summary of the sales stream: at most `capacity` products are counted. When a
+// product outside the summary sells, it takes over the smallest counter and inherits its
+// count as error. Any product selling more than total / capacity units is guaranteed to
+// be in the summary, and a counter overestimates true sales by at most its error.
+class BestSellerSketch {
 public:
-    int ID;
-    string name;
-    double price;
-    int quantity;
-    double discount;
+    struct Estimate {
+        int productID;
+        int64_t units;  // Upper bound on units sold
+        int64_t error;  // units - error is a lower bound
+    };
 
-    CartItem(int ID, string name, double price, int quantity, double discount)
-        : ID(ID), name(name), price(price), quantity(quantity), discount(discount) {}
+private:
+    IndexedMinHeap counters;           // productID -> estimated units
+    unordered_map<int, int64_t> errors;
+    size_t capacity;
+
+public:
+    explicit BestSellerSketch(size_t capacity = 256) : capacity(max<size_t>(1, capacity)) {
+        counters.reserve(this->capacity);
+        errors.reserve(this->capacity);
+    }
+
+    void add(int productID, int64_t units) {
+        if (const IndexedMinHeap::Entry* counter = counters.find(productID)) {
+            counters.set(productID, counter->priority + units);
+        } else if (counters.size() < capacity) {
+            counters.set(productID, units);
+            errors[productID] = 0;
+        } else {
+            IndexedMinHeap::Entry smallest = counters.top();
+            counters.erase(smallest.key);
+            errors.erase(smallest.key);
+            counters.set(productID, smallest.priority + units);
+            errors[productID] = smallest.priority;
+        }
+    }
+
+    // The count products with the highest estimates, best first
+    vector<Estimate> top(size_t count) const {
+        vector<Estimate> estimates;
+        estimates.reserve(counters.size());
+        for (const auto& counter : counters.entries()) {
+            estimates.push_back({counter.key, counter.priority, errors.at(counter.key)});
+        }
+        count = min(count, estimates.size());
+        partial_sort(estimates.begin(), estimates.begin() + count, estimates.end(), [](const Estimate& a, const Estimate& b) {
+            return a.units != b.units ? a.units > b.units : a.productID < b.productID;
+        });
+        estimates.resize(count);
+        return estimates;
+    }
 };
 
-// Shopping Cart Class
-class ShoppingCart {
+// Sales Aggregator Class
+// Rolling per-product and per-category sales over the last hour, day and 30 days. Each
+// window is a ring of fixed-width buckets (minutes, hours, days). A sale is added to the
+// current bucket and to the window total; when a bucket ages out its tallies are subtracted
+// again, so a report only walks what actually sold in the window.
+class SalesAggregator {
 public:
-    list<CartItem>cart;            // Linked list for dynamic cart storage
-    stack<list<CartItem>> undoStack; // Stack for undo operations
+    enum Window { LAST_HOUR, LAST_DAY, LAST_30_DAYS, WINDOW_COUNT };
+
+    struct Tally {
+        int64_t units = 0;
+        Money revenue;
+    };
+
+    struct ReportLine {
+        string label;
+        Tally tally;
+    };
+
+private:
+    struct Bucket {
+        unordered_map<int, Tally> byProduct;
+        unordered_map<uint32_t, Tally> byCategory;
+    };
+
+    struct Rollup {
+        int64_t width = 0;        // Seconds per bucket
+        vector<Bucket> buckets;   // Ring indexed by (time / width) % size; cleared, never freed
+        int64_t latest = -1;      // Newest bucket number seen
+        unordered_map<int, Tally> productTotals;
+        unordered_map<uint32_t, Tally> categoryTotals;
+    };
+
+    Rollup rollups[WINDOW_COUNT];
+    unordered_map<int, string> productNames;
+    unordered_map<string, uint32_t> categoryIDs;
+    vector<string> categoryNames;
+    BestSellerSketch bestSellers;  // All-time heavy hitters
+    mutable mutex lock;
+
+    template <typename Key>
+    static void subtract(unordered_map<Key, Tally>& totals, const unordered_map<Key, Tally>& expired) {
+        for (const auto& entry : expired) {
+            auto total = totals.find(entry.first);
+            if (total == totals.end()) continue;
+            total->second.units -= entry.second.units;
+            total->second.revenue -= entry.second.revenue;
+            if (total->second.units == 0 && total->second.revenue.isZero()) totals.erase(total);
+        }
+    }
+
+    // Age out every bucket between the newest one seen and now's; returns now's bucket
+    static Bucket& advance(Rollup& rollup, int64_t now) {
+        int64_t size = (int64_t)rollup.buckets.size();
+        int64_t current = max(now / rollup.width, rollup.latest);  // A clock step back stays in the newest bucket
+        int64_t first = rollup.latest < 0 ? current : max(rollup.latest + 1, current - size + 1);
+        for (int64_t number = first; number <= current; number++) {
+            Bucket& bucket = rollup.buckets[number % size];
+            subtract(rollup.productTotals, bucket.byProduct);
+            subtract(rollup.categoryTotals, bucket.byCategory);
+            bucket.byProduct.clear();
+            bucket.byCategory.clear();
+        }
+        rollup.latest = current;
+        return rollup.buckets[current % size];
+    }
+
+    uint32_t categoryID(const string& category) {
+        auto found = categoryIDs.find(category);
+        if (found != categoryIDs.end()) return found->second;
+        uint32_t id = (uint32_t)categoryNames.size();
+        categoryIDs.emplace(category, id);
+        categoryNames.push_back(category.empty() ? "Uncategorized" : category);
+        return id;
+    }
+
+    static void add(Tally& tally, int units, Money revenue) {
+        tally.units += units;
+        tally.revenue += revenue;
+    }
+
+    static vector<ReportLine> sorted(vector<ReportLine> lines) {
+        sort(lines.begin(), lines.end(), [](const ReportLine& a, const ReportLine& b) {
+            return a.tally.revenue != b.tally.revenue ? a.tally.revenue > b.tally.revenue : a.label < b.label;
+        });
+        return lines;
+    }
 
 public:
-    // Add Item to Cart
-    void addItem(int ID, string name, double price, int quantity, double discount) {
-        cart.push_back(CartItem(ID, name, price, quantity, discount));
-        undoStack.push(cart); // Save state for undo functionality
-        cout << "Item added to cart: " << name << " (Quantity: " << quantity << ")\n";
+    SalesAggregator() {
+        const int64_t widths[WINDOW_COUNT] = {60, 3600, 86400};
+        const size_t counts[WINDOW_COUNT] = {60, 24, 30};
+        for (int window = 0; window < WINDOW_COUNT; window++) {
+            rollups[window].width = widths[window];
+            rollups[window].buckets.resize(counts[window]);
+        }
     }
 
-    // Remove Last Added Item
-    void removeLastItem() {
-        if (!cart.empty()) {
-            cart.pop_back();
-            undoStack.push(cart); // Save state
-            cout << "Last item removed from cart.\n";
-        } else {
-            cout << "Cart is empty. Nothing to remove.\n";
+    SalesAggregator(const SalesAggregator&) = delete;
+    SalesAggregator& operator=(const SalesAggregator&) = delete;
+
+    static const char* windowName(Window window) {
+        static const char* const names[WINDOW_COUNT] = {"Last Hour", "Last 24 Hours", "Last 30 Days"};
+        return names[window];
+    }
+
+    // Seconds since the Unix epoch
+    static int64_t currentTime() {
+        return chrono::duration_cast<chrono::seconds>(chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // Record one sold line. Thread-safe.
+    void record(int productID, const string& name, const string& category, int units, Money revenue,
+                int64_t now = currentTime()) {
+        lock_guard<mutex> guard(lock);
+        recordLocked(productID, name, categoryID(category), units, revenue, now);
+    }
+
+    // Record every line of a placed order, filed under the product's current category
+    void recordOrder(const vector<CartItem>& items, const function<string(int)>& categoryOf,
+                     int64_t now = currentTime()) {
+        lock_guard<mutex> guard(lock);
+        for (const auto& item : items) {
+            recordLocked(item.ID, item.name, categoryID(categoryOf(item.ID)), item.quantity,
+                         CartPricing::lineTotal(item), now);
         }
     }
 
-    // Undo Last Operation
-    void undoLastAction() {
-        if (!undoStack.empty()) {
-            undoStack.pop(); // Remove the last saved state
-            cart = undoStack.empty() ? list<CartItem>() : undoStack.top();
-            cout << "Undo successful. Current cart size: " << cart.size() << endl;
-        } else {
-            cout << "No actions to undo.\n";
+private:
+    void recordLocked(int productID, const string& name, uint32_t category, int units, Money revenue, int64_t now) {
+        productNames.try_emplace(productID, name);
+        bestSellers.add(productID, units);
+        for (Rollup& rollup : rollups) {
+            Bucket& bucket = advance(rollup, now);
+            add(bucket.byProduct[productID], units, revenue);
+            add(bucket.byCategory[category], units, revenue);
+            add(rollup.productTotals[productID], units, revenue);
+            add(rollup.categoryTotals[category], units, revenue);
         }
     }
 
-    // Update Quantity of an Existing Item
-    void updateQuantity(int ID, int newQuantity) {
-        for (auto& item : cart) {
-            if (item.ID == ID) {
-                item.quantity = newQuantity;
-                undoStack.push(cart); // Save state
-                cout << "Quantity updated for item: " << item.name << " (New Quantity: " << newQuantity << ")\n";
-                return;
-            }
+public:
+    // Products sold in the window, highest revenue first
+    vector<ReportLine> productReport(Window window, int64_t now = currentTime()) {
+        lock_guard<mutex> guard(lock);
+        Rollup& rollup = rollups[window];
+        advance(rollup, now);
+        vector<ReportLine> lines;
+        lines.reserve(rollup.productTotals.size());
+        for (const auto& entry : rollup.productTotals) {
+            lines.push_back({productNames[entry.first] + " (ID " + to_string(entry.first) + ")", entry.second});
+        }
+        return sorted(std::move(lines));
+    }
+
+    // Estimated all-time best sellers, best first, with product names
+    vector<pair<string, BestSellerSketch::Estimate>> topSellers(size_t count) {
+        lock_guard<mutex> guard(lock);
+        vector<pair<string, BestSellerSketch::Estimate>> result;
+        for (const auto& estimate : bestSellers.top(count)) result.push_back({productNames[estimate.productID], estimate});
+        return result;
+    }
+
+    // Categories sold in the window, highest revenue first
+    vector<ReportLine> categoryReport(Window window, int64_t now = currentTime()) {
+        lock_guard<mutex> guard(lock);
+        Rollup& rollup = rollups[window];
+        advance(rollup, now);
+        vector<ReportLine> lines;
+        lines.reserve(rollup.categoryTotals.size());
+        for (const auto& entry : rollup.categoryTotals) {
+            lines.push_back({categoryNames[entry.first], entry.second});
+        }
+        return sorted(std::move(lines));
+    }
+};
+
+// Checkout and Order Management Class
+// checkout/placeOrder may be called from several lanes (threads) at once.
+class CheckoutAndOrderManager {
+private:
+    ShardedOrderQueue orderQueue;  // Pending orders
+    atomic<int> nextOrderID;
+    mutex arrivalLock;             // Idle fulfillment workers park on arrival
+    condition_variable arrival;
+    atomic<size_t> waiters;
+    InventoryManagement* inventory;  // Stock to draw from, if attached
+    WriteAheadLog* journal;          // Mutation log, if attached
+    DemandTracker* demand;           // Live sales figures, if attached
+    OperationLog* operations;        // Operation history, if attached
+    SalesAggregator* sales;          // Sales rollups, if attached
+
+    static void writeItems(SnapshotBuffer& out, const vector<CartItem>& items) {
+        out.put<uint32_t>((uint32_t)items.size());
+        for (const auto& item : items) {
+            out.put<int32_t>(item.ID);
+            out.put<int32_t>(item.quantity);
+            out.putMoney(item.price);
+            out.put<double>(item.discount);
+            out.putString(item.name);
+        }
+    }
+
+    static bool readItems(SnapshotReader& in, vector<CartItem>& items) {
+        uint32_t itemCount;
+        if (!in.get(itemCount)) return false;
+        for (uint32_t i = 0; i < itemCount; i++) {
+            int32_t ID, quantity;
+            Money price;
+            double discount;
+            string name;
+            if (!in.get(ID) || !in.get(quantity) || !in.getMoney(price) || !in.get(discount) || !in.getString(name)) return false;
+            items.push_back(CartItem(ID, name, price, quantity, discount));
+        }
+        return true;
+    }
+
+    // Price items with the default tax and no promotion
+    static Money quote(const vector<CartItem>& items) {
+        CartPricing pricing;
+        for (const auto& item : items) pricing.addLine(item);
+        return pricing.total();
+    }
+
+    void raiseNextOrderID(int orderID) {
+        int expected = nextOrderID.load();
+        while (expected <= orderID && !nextOrderID.compare_exchange_weak(expected, orderID + 1)) {
+        }
+    }
+
+public:
+    // Constructor
+    CheckoutAndOrderManager() : nextOrderID(1), waiters(0), inventory(nullptr), journal(nullptr), demand(nullptr), operations(nullptr), sales(nullptr) {}
+
+    CheckoutAndOrderManager(const CheckoutAndOrderManager&) = delete;
+    CheckoutAndOrderManager& operator=(const CheckoutAndOrderManager&) = delete;
+
+    // Record every subsequent checkout and fulfillment in the log (nullptr to stop)
+    void attachLog(WriteAheadLog* log) {
+        journal = log;
+    }
+
+    // Decrement stock for tracked products at checkout (nullptr to stop)
+    void attachInventory(InventoryManagement* stock) {
+        inventory = stock;
+    }
+
+    // Report every placed order's sales to a demand tracker (nullptr to stop)
+    void attachDemandTracker(DemandTracker* tracker) {
+        demand = tracker;
+    }
+
+    // Record every placed order in an operation log (nullptr to stop)
+    void attachOperationLog(OperationLog* log) {
+        operations = log;
+    }
+
+    // Feed every placed order's lines to sales rollups (nullptr to stop)
+    void attachSalesAggregator(SalesAggregator* aggregator) {
+        sales = aggregator;
+    }
+
+    size_t pendingCount() const {
+        return orderQueue.size();
+    }
+
+    // Visit every pending order, oldest first
+    void forEachPending(const function<void(const Order&)>& visit) {
+        orderQueue.forEachPending(visit);
+    }
+
+    // Place an order without console output. Thread-safe. Returns the new order ID, or 0 if
+    // the cart is empty or a line cannot be reserved (its ID is stored in shortItemID).
+    int placeOrder(vector<CartItem> cart, unsigned lane, int& shortItemID) {
+        Money total = quote(cart);
+        return placeOrder(std::move(cart), total, lane, shortItemID);
+    }
+
+    // Same, with the order total already priced
+    int placeOrder(vector<CartItem> cart, Money total, unsigned lane, int& shortItemID) {
+        shortItemID = 0;
+        if (cart.empty()) return 0;
+        int orderID = 0;
+        auto journalCheckout = [&]() {
+            orderID = nextOrderID++;
+            if (!journal) return;
+            SnapshotBuffer record;
+            record.put<int32_t>(orderID);
+            record.put<uint32_t>(lane);
+            writeItems(record, cart);
+            record.putMoney(total);
+            journal->append(WriteAheadLog::CHECKOUT, record);
+        };
+        if (inventory) {
+            // Journaled while the reservation still holds off product updates
+            shortItemID = inventory->reserveStock(cart, journalCheckout);
+            if (shortItemID) return 0;
+        } else {
+            journalCheckout();
         }
-        cout << "Item with ID " << ID << " not found in cart.\n";
+        if (journal) journal->commit();
+        if (demand) {
+            for (const auto& item : cart) demand->recordSale(item.ID, item.quantity);
+        }
+        if (sales) {
+            sales->recordOrder(cart, [&](int productID) { return inventory ? inventory->categoryOf(productID) : string(); });
+        }
+        if (operations) operations->log(OperationLog::ORDER_PLACED, OperationLog::CUSTOMER, 0, orderID);
+        orderQueue.push(orderID, std::move(cart), total, lane);
+        if (waiters.load()) wakeWaiters();  // Checked after the push, so a parking worker sees one or the other
+        return orderID;
     }
 
-    // Display Cart Summary
-    void displayCart(double taxRate = 0.1) {
+    // Checkout Process; returns the new order ID, or 0 if no order was placed
+    int checkout(ShoppingCart& cart, unsigned lane = 0) {
         if (cart.empty()) {
-            cout << "Cart is empty.\n";
-            return;
+            cout << "Cart is empty. Nothing to checkout.\n";
+            return 0;
         }
 
-        double total = 0.0;
-        cout << "\n--- Cart Summary ---\n";
+        cout << "\n--- Checkout ---\n";
         for (const auto& item : cart) {
-            double itemTotal = item.price * item.quantity;
-            double itemDiscount = itemTotal * (item.discount / 100);
-            itemTotal -= itemDiscount;
-            total += itemTotal;
             cout << "Item: " << item.name
                  << ", Quantity: " << item.quantity
-                 << ", Price: $" << item.price
-                 << ", Subtotal: $" << itemTotal
-                 << " (Discount: " << item.discount << "%)\n";
+                 << ", Subtotal: $" << CartPricing::lineTotal(item) << endl;
         }
+        cart.totals().display();
 
-        double tax = total * taxRate;
-        total += tax;
-        cout << "Tax: $" << tax << "\n";
-        cout << "Total Price: $" << total << "\n";
+        int shortItemID;
+        int orderID = placeOrder(vector<CartItem>(cart.begin(), cart.end()), cart.totals().total(), lane, shortItemID);
+        if (!orderID) {
+            cout << "Not enough stock for product ID " << shortItemID << ". Order not placed.\n";
+            return 0;
+        }
+        cart.clear(); // Clear the cart (and its undo history) after checkout
+        cout << "Order placed successfully. Order ID: " << orderID << endl;
+        return orderID;
     }
-};
-
-// Order Class
-class Order {
-public:
-    int orderID;
-    list<CartItem> itemList;
-    double totalPrice;
 
-    Order(int orderID, const list<CartItem>& itemList, double totalPrice)
-        : orderID(orderID), itemList(itemList), totalPrice(totalPrice) {}
-};
+    // Re-apply a logged checkout or fulfillment during recovery; returns false on a malformed
+    // record or a checkout whose stock cannot be taken again
+    bool applyLogRecord(WriteAheadLog::RecordType type, SnapshotReader& in) {
+        int32_t orderID;
+        if (!in.get(orderID)) return false;
+        if (type == WriteAheadLog::FULFILL_ORDER) {
+            orderQueue.remove(orderID);
+            return true;
+        }
 
-// Checkout and Order Management Class
-class CheckoutAndOrderManager {
-private:
-    queue<Order> orderQueue; // Queue for managing orders
-    int nextOrderID;
+        uint32_t lane;
+        vector<CartItem> cart;
+        Money total;
+        if (!in.get(lane) || !readItems(in, cart) || !in.getMoney(total)) return false;
+        if (inventory && inventory->reserveStock(cart)) return false;  // Snapshot and log disagree on stock
+        orderQueue.push(orderID, std::move(cart), total, lane);
+        raiseNextOrderID(orderID);
+        return true;
+    }
 
-public:
-    // Constructor
-    CheckoutAndOrderManager() : nextOrderID(1) {}
+    // Write the pending orders and the order ID counter to a snapshot section
+    void writeSnapshot(SnapshotBuffer& out) {
+        out.put<int32_t>(nextOrderID.load());
+        out.put<uint64_t>(orderQueue.size());
+        orderQueue.forEachPending([&](const Order& order) {
+            out.put<int32_t>(order.orderID);
+            out.put<uint32_t>(order.lane);
+            out.putMoney(order.totalPrice);
+            writeItems(out, order.itemList);
+        });
+    }
 
-    // Checkout Process
-    void checkout(list<CartItem>& cart) {
-        if (cart.empty()) {
-            cout << "Cart is empty. Nothing to checkout.\n";
-            return;
+    // Restore pending orders from a snapshot section; returns false on truncated data
+    bool readSnapshot(SnapshotReader& in) {
+        int32_t savedNextOrderID;
+        uint64_t count;
+        if (!in.get(savedNextOrderID) || !in.get(count)) return false;
+        for (uint64_t i = 0; i < count; i++) {
+            int32_t orderID;
+            uint32_t lane;
+            Money totalPrice;
+            vector<CartItem> itemList;
+            if (!in.get(orderID) || !in.get(lane) || !in.getMoney(totalPrice) || !readItems(in, itemList)) return false;
+            orderQueue.push(orderID, std::move(itemList), totalPrice, lane);
         }
+        raiseNextOrderID(savedNextOrderID - 1);
+        return true;
+    }
 
-        double total = 0.0;
-        cout << "\n--- Checkout ---\n";
-        for (const auto& item : cart) {
-            double itemTotal = item.price * item.quantity;
-            total += itemTotal;
-            cout << "Item: " << item.name
-                 << ", Quantity: " << item.quantity
-                 << ", Subtotal: $" << itemTotal << endl;
+    // Remove up to maxOrders of the oldest pending orders for asynchronous fulfillment.
+    // Each must later be passed to recordFulfilled.
+    size_t takeOldest(size_t maxOrders, vector<Order>& batch) {
+        size_t taken = 0;
+        while (taken < maxOrders && orderQueue.popOldest([&](const Order& order) { batch.push_back(order); })) {
+            taken++;
         }
+        return taken;
+    }
+
+    // Block until an order is pending or cancelled is set (followed by wakeWaiters)
+    void waitForOrders(const atomic<bool>& cancelled) {
+        unique_lock<mutex> guard(arrivalLock);
+        waiters++;
+        arrival.wait(guard, [&] { return cancelled.load() || !orderQueue.empty(); });
+        waiters--;
+    }
 
-        cout << "Total Price: $" << total << endl;
+    void wakeWaiters() {
+        { lock_guard<mutex> guard(arrivalLock); }
+        arrival.notify_all();
+    }
 
-        // Place order in queue
-        orderQueue.push(Order(nextOrderID++, cart, total));
-        cart.clear(); // Clear the cart after checkout
-        cout << "Order placed successfully. Order ID: " << nextOrderID - 1 << endl;
+    // Journal an order taken with takeOldest as fulfilled. Thread-safe.
+    void recordFulfilled(const Order& order) {
+        if (journal) {
+            SnapshotBuffer record;
+            record.put<int32_t>(order.orderID);
+            journal->append(WriteAheadLog::FULFILL_ORDER, record);
+            journal->commit();
+        }
     }
 
-    // Fulfill Order (FIFO)
+    // Fulfill Order (oldest first)
     void fulfillOrder() {
-        if (orderQueue.empty()) {
+        // Copy the order out so the journal commit and output happen after the shard is unlocked
+        vector<Order> taken;
+        if (!takeOldest(1, taken)) {
             cout << "No pending orders to fulfill.\n";
             return;
         }
-
-        Order currentOrder = orderQueue.front();
-        orderQueue.pop();
+        const Order& currentOrder = taken.front();
+        recordFulfilled(currentOrder);
 
         cout << "\n--- Fulfilling Order ---\n";
         cout << "Order ID: " << currentOrder.orderID << "\nItems:\n";
@@ -354,13 +4775,197 @@ public:
         }
 
         cout << "\n--- Pending Orders ---\n";
-        queue<Order> tempQueue = orderQueue;
-        while (!tempQueue.empty()) {
-            Order currentOrder = tempQueue.front();
-            tempQueue.pop();
+        orderQueue.forEachPending([](const Order& currentOrder) {
             cout << "Order ID: " << currentOrder.orderID
                  << ", Total Price: $" << currentOrder.totalPrice << "\n";
+        });
+    }
+};
+
+// Fulfillment Scheduler Class
+// Pool of workers fulfilling pending orders. Each worker refills its own deque with a
+// batch of the oldest pending orders and works through it front to back; a worker with
+// nothing to do steals from the back of another worker's deque.
+class FulfillmentScheduler {
+public:
+    struct Completion {
+        int orderID;
+        unsigned lane;
+        Money totalPrice;
+        size_t worker;
+        double waitMs;    // From checkout until a worker started on the order
+        double commitMs;  // Journaling the fulfillment; the completion callback runs after
+    };
+
+private:
+    struct WorkerQueue {
+        mutex lock;
+        deque<Order> orders;
+    };
+
+    static constexpr size_t MAX_SAMPLES = 65536;
+
+    CheckoutAndOrderManager& orderManager;
+    function<void(const Completion&)> onComplete;
+    size_t batchSize;
+    size_t workerCount;
+    unique_ptr<WorkerQueue[]> queues;
+    vector<thread> workers;
+    atomic<bool> stopping;
+    atomic<size_t> completed;
+    atomic<size_t> steals;
+    atomic<size_t> queued;      // Orders sitting in worker deques
+    atomic<size_t> maxDepth;
+
+    mutex metricsLock;
+    vector<double> waitSamples;     // Most recent MAX_SAMPLES, ring-buffered
+    vector<double> latencySamples;  // From start until journaled and reported to onComplete
+    size_t sampleCursor;
+
+    bool popOwn(size_t worker, Order& order) {
+        WorkerQueue& queue = queues[worker];
+        lock_guard<mutex> guard(queue.lock);
+        if (queue.orders.empty()) return false;
+        order = move(queue.orders.front());
+        queue.orders.pop_front();
+        queued--;
+        return true;
+    }
+
+    bool steal(size_t thief, Order& order) {
+        for (size_t offset = 1; offset < workerCount; offset++) {
+            WorkerQueue& victim = queues[(thief + offset) % workerCount];
+            lock_guard<mutex> guard(victim.lock);
+            if (victim.orders.empty()) continue;
+            order = move(victim.orders.back());
+            victim.orders.pop_back();
+            queued--;
+            steals++;
+            return true;
+        }
+        return false;
+    }
+
+    bool refill(size_t worker, Order& order) {
+        vector<Order> batch;
+        if (!orderManager.takeOldest(batchSize, batch)) return false;
+        order = move(batch.front());
+        WorkerQueue& queue = queues[worker];
+        lock_guard<mutex> guard(queue.lock);
+        for (size_t i = 1; i < batch.size(); i++) queue.orders.push_back(move(batch[i]));
+        queued += batch.size() - 1;
+        return true;
+    }
+
+    void recordDepth() {
+        size_t depth = orderManager.pendingCount() + queued.load();
+        size_t seen = maxDepth.load();
+        while (depth > seen && !maxDepth.compare_exchange_weak(seen, depth)) {
+        }
+    }
+
+    void fulfill(size_t worker, const Order& order) {
+        auto started = chrono::steady_clock::now();
+        orderManager.recordFulfilled(order);
+
+        Completion completion;
+        completion.orderID = order.orderID;
+        completion.lane = order.lane;
+        completion.totalPrice = order.totalPrice;
+        completion.worker = worker;
+        completion.waitMs = chrono::duration<double, milli>(started - order.placedAt).count();
+        completion.commitMs = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+        if (onComplete) onComplete(completion);
+        double latencyMs = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+        {
+            lock_guard<mutex> guard(metricsLock);
+            if (waitSamples.size() < MAX_SAMPLES) {
+                waitSamples.push_back(completion.waitMs);
+                latencySamples.push_back(latencyMs);
+            } else {
+                waitSamples[sampleCursor] = completion.waitMs;
+                latencySamples[sampleCursor] = latencyMs;
+                sampleCursor = (sampleCursor + 1) % MAX_SAMPLES;
+            }
         }
+        completed++;
+    }
+
+    void run(size_t worker) {
+        Order order;
+        while (true) {
+            recordDepth();
+            if (popOwn(worker, order) || steal(worker, order) || refill(worker, order)) {
+                fulfill(worker, order);
+                continue;
+            }
+            if (stopping) break;  // nothing left anywhere
+            orderManager.waitForOrders(stopping);
+        }
+    }
+
+    static double percentile(vector<double> samples, double fraction) {
+        if (samples.empty()) return 0.0;
+        size_t rank = (size_t)(fraction * (samples.size() - 1));
+        nth_element(samples.begin(), samples.begin() + rank, samples.end());
+        return samples[rank];
+    }
+
+public:
+    // onComplete is called from worker threads and must be thread-safe
+    FulfillmentScheduler(CheckoutAndOrderManager& orderManager, function<void(const Completion&)> onComplete = nullptr,
+                         size_t batchSize = 32)
+        : orderManager(orderManager), onComplete(onComplete), batchSize(max<size_t>(1, batchSize)), workerCount(0),
+          stopping(false), completed(0), steals(0), queued(0), maxDepth(0), sampleCursor(0) {}
+
+    ~FulfillmentScheduler() { stop(); }
+
+    FulfillmentScheduler(const FulfillmentScheduler&) = delete;
+    FulfillmentScheduler& operator=(const FulfillmentScheduler&) = delete;
+
+    // Workers beyond this only contend for the order shards
+    static size_t maxWorkers() {
+        return 4 * (size_t)max(1u, thread::hardware_concurrency());
+    }
+
+    // Start between 1 and maxWorkers() workers
+    void start(size_t workerThreads) {
+        if (!workers.empty()) return;
+        workerCount = min(max<size_t>(1, workerThreads), maxWorkers());
+        queues.reset(new WorkerQueue[workerCount]);
+        stopping = false;
+        for (size_t i = 0; i < workerCount; i++) {
+            workers.emplace_back(&FulfillmentScheduler::run, this, i);
+        }
+    }
+
+    // Finish every pending order, then join the workers
+    void stop() {
+        stopping = true;
+        orderManager.wakeWaiters();
+        for (thread& worker : workers) worker.join();
+        workers.clear();
+    }
+
+    size_t queueDepth() const {
+        return orderManager.pendingCount() + queued.load();
+    }
+
+    void displayMetrics() {
+        vector<double> waits, latencies;
+        {
+            lock_guard<mutex> guard(metricsLock);
+            waits = waitSamples;
+            latencies = latencySamples;
+        }
+        cout << "\n--- Fulfillment Metrics ---\n";
+        cout << "Workers: " << workerCount << ", Orders Fulfilled: " << completed.load()
+             << ", Steals: " << steals.load() << "\n";
+        cout << "Queue Depth: " << queueDepth() << " (peak " << maxDepth.load() << ")\n";
+        cout << "Wait (ms): p50 " << percentile(waits, 0.50) << ", p95 " << percentile(waits, 0.95)
+             << ", p99 " << percentile(waits, 0.99) << "\n";
+        cout << "Fulfillment Latency (ms): p50 " << percentile(latencies, 0.50) << ", p95 " << percentile(latencies, 0.95)
+             << ", p99 " << percentile(latencies, 0.99) << "\n";
     }
 };
 
@@ -379,69 +4984,310 @@ public:
 // Analytics and Reporting Class
 class AnalyticsAndReporting {
 private:
-    stack<string> systemLogs;           // Stack for logging operations
-    priority_queue<pair<int, string>> lowStockQueue; // Priority queue for low-stock alerts
-    map<string, int> salesByCategory;   // Map for sales by category
+    OperationLog* operations = nullptr; // Operation history, if attached
+    InventoryManagement* inventory = nullptr;  // Stock levels, if attached
+    SalesAggregator salesRollups;       // Rolling sales by product and category
 
 public:
+    // Record admin operations in an operation log (nullptr to stop)
+    void attachOperationLog(OperationLog* log) {
+        operations = log;
+    }
+
     // Log System Operation
-    void logOperation(const string& operation) {
-        systemLogs.push(operation);
-        cout << "Logged operation: " << operation << endl;
+    void logOperation(OperationLog::OpCode op, int productID = 0, int64_t value = 0) {
+        if (operations) operations->log(op, OperationLog::ADMIN, productID, value);
+    }
+
+    // Read stock levels for the dashboard from this inventory (nullptr to stop)
+    void attachInventory(InventoryManagement* stock) {
+        inventory = stock;
+    }
+
+    // Rollups fed by checkout (see CheckoutAndOrderManager::attachSalesAggregator)
+    SalesAggregator& sales() {
+        return salesRollups;
     }
 
     // Generate Sales Report by Product
-    void generateSalesReportByProduct(map<string, int>& salesData) {
-        cout << "\n--- Sales Report by Product ---\n";
-        for (const auto& entry : salesData) {
-            cout << "Product: " << entry.first << ", Sales: " << entry.second << endl;
+    void generateSalesReportByProduct(SalesAggregator::Window window) {
+        cout << "\n--- Sales Report by Product (" << SalesAggregator::windowName(window) << ") ---\n";
+        vector<SalesAggregator::ReportLine> lines = salesRollups.productReport(window);
+        if (lines.empty()) cout << "No sales in this period.\n";
+        for (const auto& line : lines) {
+            cout << "Product: " << line.label << ", Units: " << line.tally.units << ", Revenue: $" << line.tally.revenue << endl;
         }
     }
 
     // Generate Sales Report by Category
-    void generateSalesReportByCategory() {
-        cout << "\n--- Sales Report by Category ---\n";
-        for (const auto& entry : salesByCategory) {
-            cout << "Category: " << entry.first << ", Sales: " << entry.second << endl;
+    void generateSalesReportByCategory(SalesAggregator::Window window) {
+        cout << "\n--- Sales Report by Category (" << SalesAggregator::windowName(window) << ") ---\n";
+        vector<SalesAggregator::ReportLine> lines = salesRollups.categoryReport(window);
+        if (lines.empty()) cout << "No sales in this period.\n";
+        for (const auto& line : lines) {
+            cout << "Category: " << line.label << ", Units: " << line.tally.units << ", Revenue: $" << line.tally.revenue << endl;
         }
     }
 
-    // Highlight Low Stock Items
-    void addLowStockItem(const string& name, int stock) {
-        lowStockQueue.push({-stock, name}); // Use negative stock for ascending order in priority queue
-    }
-
-    void displayLowStockAlerts() {
-        if (lowStockQueue.empty()) {
+    // Highlight the count products with the least stock
+    void displayLowStockAlerts(size_t count = 10) {
+        vector<pair<ItemNode*, int>> items;
+        if (inventory) items = inventory->lowestStock(count);
+        if (items.empty()) {
             cout << "No low stock items.\n";
             return;
         }
 
         cout << "\n--- Low Stock Alerts ---\n";
-        while (!lowStockQueue.empty()) {
-            auto item = lowStockQueue.top();
-            lowStockQueue.pop();
-            cout << "Product: " << item.second << " has only " << -item.first << " left in stock.\n";
+        for (const auto& item : items) {
+            cout << "Product: " << item.first->name << " has only " << item.second << " left in stock.\n";
+        }
+    }
+
+    // Display the count best-selling products since startup
+    void displayBestSellers(size_t count = 10) {
+        vector<pair<string, BestSellerSketch::Estimate>> sellers = salesRollups.topSellers(count);
+        if (sellers.empty()) {
+            cout << "No sales recorded yet.\n";
+            return;
+        }
+
+        cout << "\n--- Best Sellers ---\n";
+        for (const auto& seller : sellers) {
+            cout << "Product: " << seller.first << " (ID " << seller.second.productID << "), Units Sold: " << seller.second.units;
+            if (seller.second.error) cout << " (at least " << seller.second.units - seller.second.error << ")";
+            cout << endl;
         }
     }
 
-    // Display System Logs
-    void displaySystemLogs() {
-        if (systemLogs.empty()) {
+    // Display System Logs, newest first (the history is kept)
+    void displaySystemLogs(size_t limit = 100) {
+        vector<OperationLog::Record> records;
+        if (operations) records = operations->recent(limit);
+        if (records.empty()) {
             cout << "No system logs available.\n";
             return;
         }
 
         cout << "\n--- System Logs ---\n";
-        while (!systemLogs.empty()) {
-            cout << systemLogs.top() << endl;
-            systemLogs.pop();
+        for (const auto& record : records) {
+            cout << OperationLog::format(record) << endl;
+        }
+        cout << "Showing " << records.size() << " of " << operations->recorded() << " operations logged";
+        if (operations->lost()) cout << " (" << operations->lost() << " overwritten before reaching the log file)";
+        cout << ".\n";
+    }
+};
+
+// Promo Code Store Class
+// Holds issued promotional codes by 64-bit hash of the code text; the text itself is not
+// kept. Entries live in a deque (stable addresses for their atomic redemption counters)
+// and are found through an open-addressing table of entry indices. Lookups and
+// redemptions may run concurrently with each other and with additions.
+class PromoCodeStore {
+public:
+    enum Status { VALID, UNKNOWN, NOT_YET_VALID, EXPIRED, EXHAUSTED };
+
+private:
+    struct Entry {
+        uint64_t keyHash;
+        int64_t validFrom;        // Unix time; 0 = no start
+        int64_t validUntil;       // Unix time, exclusive; 0 = no end
+        uint32_t maxRedemptions;  // 0 = unlimited
+        uint32_t rateBasisPoints;
+        atomic<uint32_t> redemptions;
+
+        Entry(uint64_t keyHash, int64_t validFrom, int64_t validUntil, uint32_t maxRedemptions, uint32_t rateBasisPoints)
+            : keyHash(keyHash), validFrom(validFrom), validUntil(validUntil), maxRedemptions(maxRedemptions),
+              rateBasisPoints(rateBasisPoints), redemptions(0) {}
+    };
+
+    deque<Entry> entries;
+    vector<uint32_t> slots;  // Entry index + 1; 0 = empty
+    mutable shared_mutex lock;
+
+    static uint64_t hashCode(const string& code) {
+        uint64_t hash = 14695981039346656037ull;
+        for (unsigned char c : code) hash = (hash ^ c) * 1099511628211ull;
+        hash ^= hash >> 33;  // Spread the low-entropy FNV bits across the word
+        hash *= 0xff51afd7ed558ccdull;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    // Slot holding keyHash, or the empty slot where it would go
+    size_t probe(uint64_t keyHash) const {
+        size_t mask = slots.size() - 1;
+        size_t slot = (size_t)keyHash & mask;
+        while (slots[slot] && entries[slots[slot] - 1].keyHash != keyHash) slot = (slot + 1) & mask;
+        return slot;
+    }
+
+    void grow() {
+        vector<uint32_t> old(max<size_t>(16, slots.size() * 2), 0);
+        old.swap(slots);
+        for (uint32_t index : old) {
+            if (index) slots[probe(entries[index - 1].keyHash)] = index;
+        }
+    }
+
+    Entry* find(const string& code) const {
+        if (slots.empty()) return nullptr;
+        uint32_t index = slots[probe(hashCode(code))];
+        return index ? const_cast<Entry*>(&entries[index - 1]) : nullptr;
+    }
+
+    static Status usable(const Entry& entry, int64_t now) {
+        if (entry.validFrom && now < entry.validFrom) return NOT_YET_VALID;
+        if (entry.validUntil && now >= entry.validUntil) return EXPIRED;
+        if (entry.maxRedemptions && entry.redemptions.load() >= entry.maxRedemptions) return EXHAUSTED;
+        return VALID;
+    }
+
+public:
+    PromoCodeStore() = default;
+    PromoCodeStore(const PromoCodeStore&) = delete;
+    PromoCodeStore& operator=(const PromoCodeStore&) = delete;
+
+    static const char* describe(Status status) {
+        switch (status) {
+            case VALID: return "valid";
+            case UNKNOWN: return "unknown code";
+            case NOT_YET_VALID: return "not valid yet";
+            case EXPIRED: return "expired";
+            case EXHAUSTED: return "fully redeemed";
+        }
+        return "";
+    }
+
+    size_t size() const {
+        shared_lock<shared_mutex> guard(lock);
+        return entries.size();
+    }
+
+    // Pre-size for count codes
+    void reserve(size_t count) {
+        unique_lock<shared_mutex> guard(lock);
+        while (slots.size() < count * 2) grow();
+    }
+
+    // Issue a code worth discountRate (0 to 1, e.g. 0.10) off the order; returns false if
+    // the rate is out of range or the code already exists
+    bool addCode(const string& code, double discountRate, int64_t validFrom = 0, int64_t validUntil = 0,
+                 uint32_t maxRedemptions = 0) {
+        if (!(discountRate >= 0 && discountRate <= 1)) return false;
+        uint64_t keyHash = hashCode(code);
+        unique_lock<shared_mutex> guard(lock);
+        if ((entries.size() + 1) * 2 > slots.size()) grow();
+        size_t slot = probe(keyHash);
+        if (slots[slot]) return false;
+        entries.emplace_back(keyHash, validFrom, validUntil, maxRedemptions, (uint32_t)llround(discountRate * 10000));
+        slots[slot] = (uint32_t)entries.size();
+        return true;
+    }
+
+    // Validate a code without using it up
+    Status check(const string& code, double& discountRate, int64_t now) const {
+        shared_lock<shared_mutex> guard(lock);
+        const Entry* entry = find(code);
+        if (!entry) return UNKNOWN;
+        Status status = usable(*entry, now);
+        if (status == VALID) discountRate = entry->rateBasisPoints / 10000.0;
+        return status;
+    }
+
+    // Validate and use one redemption, atomically with respect to other checkouts
+    Status redeem(const string& code, double& discountRate, int64_t now) {
+        shared_lock<shared_mutex> guard(lock);
+        Entry* entry = find(code);
+        if (!entry) return UNKNOWN;
+        Status status = usable(*entry, now);
+        if (status != VALID) return status;
+        uint32_t used = entry->redemptions.load();
+        do {
+            if (entry->maxRedemptions && used >= entry->maxRedemptions) return EXHAUSTED;
+        } while (!entry->redemptions.compare_exchange_weak(used, used + 1));
+        discountRate = entry->rateBasisPoints / 10000.0;
+        return VALID;
+    }
+
+    // Give back a redemption whose order was not placed
+    void refund(const string& code) {
+        shared_lock<shared_mutex> guard(lock);
+        Entry* entry = find(code);
+        if (!entry) return;
+        uint32_t used = entry->redemptions.load();
+        while (used && !entry->redemptions.compare_exchange_weak(used, used - 1)) {
+        }
+    }
+
+    // Days since 1970-01-01 for a proleptic Gregorian date
+    static int64_t daysFromCivil(int64_t year, unsigned month, unsigned day) {
+        year -= month <= 2;
+        int64_t era = (year >= 0 ? year : year - 399) / 400;
+        unsigned yearOfEra = (unsigned)(year - era * 400);
+        unsigned dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        return era * 146097 + (int64_t)dayOfEra - 719468;
+    }
+
+    // "YYYY-MM-DD" (UTC midnight) to Unix time; empty gives 0
+    static bool parseDate(const string& text, int64_t& time) {
+        if (text.empty()) {
+            time = 0;
+            return true;
         }
+        int year;
+        unsigned month, day;
+        char extra;
+        if (sscanf(text.c_str(), "%d-%u-%u%c", &year, &month, &day, &extra) != 3 ||
+            month < 1 || month > 12 || day < 1 || day > 31) {
+            return false;
+        }
+        time = daysFromCivil(year, month, day) * 86400;
+        return true;
     }
 
-    // Track Sales and Add to Category
-    void trackSalesByCategory(const string& category, int sales) {
-        salesByCategory[category] += sales;
+    // Bulk-issue codes from a CSV file, one per line:
+    // code,discountPercent,validFrom,validUntil,maxRedemptions
+    // Dates are YYYY-MM-DD (validUntil is the first day the code no longer works) and may be
+    // blank; maxRedemptions 0 or blank is unlimited. Lines with a discountPercent outside
+    // 0-100 are rejected. Returns the number of codes added.
+    size_t loadCodes(const string& path) {
+        ifstream in(path);
+        if (!in) {
+            cout << "Could not open promo code file: " << path << "\n";
+            return 0;
+        }
+        string line;
+        size_t added = 0, rejected = 0;
+        while (getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty() || line[0] == '#') continue;
+            string fields[5];
+            size_t start = 0, count = 0;
+            while (count < 5) {
+                size_t comma = line.find(',', start);
+                fields[count++] = line.substr(start, comma == string::npos ? string::npos : comma - start);
+                if (comma == string::npos) break;
+                start = comma + 1;
+            }
+            int64_t validFrom, validUntil;
+            char* end;
+            double percent = strtod(fields[1].c_str(), &end);
+            unsigned long maxRedemptions = fields[4].empty() ? 0 : strtoul(fields[4].c_str(), nullptr, 10);
+            if (fields[0].empty() || fields[1].empty() || *end || !(percent >= 0 && percent <= 100) ||
+                !parseDate(fields[2], validFrom) || !parseDate(fields[3], validUntil) ||
+                !addCode(fields[0], percent / 100, validFrom, validUntil, (uint32_t)maxRedemptions)) {
+                rejected++;
+                continue;
+            }
+            added++;
+        }
+        cout << added << " promo codes loaded from " << path;
+        if (rejected) cout << " (" << rejected << " rejected)";
+        cout << "\n";
+        return added;
     }
 };
 
@@ -451,117 +5297,434 @@ public:
     int ID;
     string name;
     string category;
-    double price;
+    Money price;
     int quantity;
     double discount;
 
-    PromotionNode(int ID, string name, string category, double price, int quantity, double discount)
+    PromotionNode(int ID, string name, string category, Money price, int quantity, double discount)
         : ID(ID), name(name), category(category), price(price), quantity(quantity), discount(discount) {}
 };
 
 // Promotions and Discounts Class
+// Pricing rules are data (see PromotionRule) and are compiled into a PromotionTable per
+// season and promo code before evaluation.
 class PromotionsAndDiscounts {
 private:
-    map<string, double> promoCodes; // Map to store valid promotional codes and discounts
+    PromoCodeStore promoCodes;       // Issued promotional codes and their discounts
+    vector<PromotionRule> rules;
+    PromotionTable compiled;         // Cache for the last season and code evaluated
+    string compiledSeason, compiledCode;
+    bool compiledValid = false;
+
+    static PromotionRule makeRule(string name, string season, string category, int minDemand, int maxDemand,
+                                  double adjustmentPercent, int priority, bool stackable) {
+        PromotionRule rule;
+        rule.name = name;
+        rule.season = season;
+        rule.category = category;
+        rule.minDemand = minDemand;
+        rule.maxDemand = maxDemand;
+        rule.adjustmentPercent = adjustmentPercent;
+        rule.priority = priority;
+        rule.stackable = stackable;
+        return rule;
+    }
 
 public:
-    // Constructor to Initialize Promotional Codes
+    // Constructor to Initialize Promotional Codes and Default Rules
     PromotionsAndDiscounts() {
-        promoCodes["DISCOUNT10"] = 0.10;
-        promoCodes["DISCOUNT20"] = 0.20;
-        promoCodes["DISCOUNT30"] = 0.30;
+        promoCodes.addCode("DISCOUNT10", 0.10);
+        promoCodes.addCode("DISCOUNT20", 0.20);
+        promoCodes.addCode("DISCOUNT30", 0.30);
+
+        rules.push_back(makeRule("High demand", "", "", 51, INT_MAX, 20, 0, true));
+        rules.push_back(makeRule("Low demand", "", "", INT_MIN, 9, -10, 0, true));
+        rules.push_back(makeRule("Summer drinks", "Summer", "Drinks", INT_MIN, INT_MAX, -15, 10, true));
+        rules.push_back(makeRule("Winter heaters", "Winter", "Heaters", INT_MIN, INT_MAX, -20, 10, true));
+    }
+
+    // Look up a promotional code's discount rate; the code is not used up
+    PromoCodeStore::Status findPromoCode(const string& promoCode, double& discountRate) const {
+        return promoCodes.check(promoCode, discountRate, time(nullptr));
+    }
+
+    // Use one redemption of a code (at checkout); safe from concurrent checkout lanes
+    PromoCodeStore::Status redeemPromoCode(const string& promoCode, double& discountRate) {
+        return promoCodes.redeem(promoCode, discountRate, time(nullptr));
+    }
+
+    // Give back a redemption when the order was not placed
+    void refundPromoCode(const string& promoCode) {
+        promoCodes.refund(promoCode);
+    }
+
+    PromoCodeStore& codeStore() { return promoCodes; }
+
+    void addRule(const PromotionRule& rule) {
+        rules.push_back(rule);
+        compiledValid = false;
+    }
+
+    size_t ruleCount() const { return rules.size(); }
+
+    // Replace the rules with those in a CSV file, one per line:
+    // name,season,category,minDemand,maxDemand,promoCode,adjustmentPercent,priority,stackable
+    // Blank or "*" fields match anything; stackable is 1 or 0. Lines starting with # are skipped.
+    bool loadRules(const string& path) {
+        ifstream in(path);
+        if (!in) {
+            cout << "Could not open rules file: " << path << "\n";
+            return false;
+        }
+        vector<PromotionRule> loaded;
+        string line;
+        size_t lineNumber = 0;
+        while (getline(in, line)) {
+            lineNumber++;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty() || line[0] == '#') continue;
+
+            vector<string> fields;
+            size_t start = 0;
+            while (true) {
+                size_t comma = line.find(',', start);
+                string field = line.substr(start, comma == string::npos ? string::npos : comma - start);
+                fields.push_back(field == "*" ? "" : field);
+                if (comma == string::npos) break;
+                start = comma + 1;
+            }
+
+            PromotionRule rule;
+            try {
+                if (fields.size() != 9) throw invalid_argument("field count");
+                rule.name = fields[0];
+                rule.season = fields[1];
+                rule.category = fields[2];
+                if (!fields[3].empty()) rule.minDemand = stoi(fields[3]);
+                if (!fields[4].empty()) rule.maxDemand = stoi(fields[4]);
+                rule.promoCode = fields[5];
+                rule.adjustmentPercent = stod(fields[6]);
+                rule.priority = fields[7].empty() ? 0 : stoi(fields[7]);
+                rule.stackable = fields[8] != "0";
+            } catch (const exception&) {
+                cout << "Invalid rule on line " << lineNumber << " of " << path << "\n";
+                return false;
+            }
+            loaded.push_back(rule);
+        }
+        rules.swap(loaded);
+        compiledValid = false;
+        cout << rules.size() << " promotion rules loaded from " << path << "\n";
+        return true;
+    }
+
+    // Decision table for a season and promo code (either may be empty)
+    const PromotionTable& compiledRules(const string& season, const string& promoCode) {
+        if (!compiledValid || season != compiledSeason || promoCode != compiledCode) {
+            compiled = PromotionTable(rules, season, promoCode);
+            compiledSeason = season;
+            compiledCode = promoCode;
+            compiledValid = true;
+        }
+        return compiled;
+    }
+
+    // Apply every matching rule to one product
+    void applyPromotions(PromotionNode& product, const string& season, int demand, const string& promoCode = "") {
+        Money price = compiledRules(season, promoCode).price(product.category, product.price, demand);
+        if (price == product.price) {
+            cout << "No promotions apply to " << product.name << ".\n";
+            return;
+        }
+        product.price = price;
+        cout << "Promotions applied: New price for " << product.name << " is $" << product.price << endl;
     }
 
     // Apply Discount Based on Demand
     void applyDynamicPricing(PromotionNode& product, int demand) {
-        if (demand > 50) {
-            product.price *= 1.20; // Increase price by 20% for high demand
-            cout << "Dynamic pricing applied: New price for " << product.name << " is $" << product.price << endl;
-        } else if (demand < 10) {
-            product.price *= 0.90; // Decrease price by 10% for low demand
-            cout << "Dynamic pricing applied: New price for " << product.name << " is $" << product.price << endl;
+        applyPromotions(product, "", demand);
+    }
+
+    // Apply Promotional Code
+    void applyPromoCode(PromotionNode& product, const string& promoCode) {
+        double discountRate;
+        PromoCodeStore::Status status = findPromoCode(promoCode, discountRate);
+        if (status == PromoCodeStore::VALID) {
+            product.price = product.price.scaled(1 - discountRate);
+            cout << "Promo code applied: New price for " << product.name << " is $" << product.price << endl;
         } else {
-            cout << "No dynamic pricing applied for " << product.name << ".\n";
+            cout << "Invalid promo code: " << promoCode << " (" << PromoCodeStore::describe(status) << ")" << endl;
+        }
+    }
+};
+
+// Dynamic Pricing Scheduler Class
+// Background job that periodically merges live demand into the catalog and reprices it
+// with the rules of the inventory's active promotion. Dynamic prices derive from each
+// product's list price, so passes do not compound, and they are not journaled: they are recomputed
+// from live demand after a restart. Checkout never waits for a pass; console actions that
+// change the catalog hold holdPasses() so they do not overlap one.
+class DynamicPricingScheduler {
+private:
+    DemandTracker& tracker;
+    InventoryManagement& inventory;
+    PromotionsAndDiscounts& promotions;
+    mutex passLock;
+    mutex wakeLock;
+    condition_variable wake;
+    thread worker;
+    bool stopping;
+    atomic<size_t> passes;
+    atomic<size_t> lastRepriced;
+
+public:
+    DynamicPricingScheduler(DemandTracker& tracker, InventoryManagement& inventory, PromotionsAndDiscounts& promotions)
+        : tracker(tracker), inventory(inventory), promotions(promotions), stopping(false), passes(0), lastRepriced(0) {}
+
+    ~DynamicPricingScheduler() { stop(); }
+
+    DynamicPricingScheduler(const DynamicPricingScheduler&) = delete;
+    DynamicPricingScheduler& operator=(const DynamicPricingScheduler&) = delete;
+
+    void start(chrono::milliseconds interval) {
+        if (worker.joinable()) return;
+        stopping = false;
+        worker = thread([this, interval] {
+            unique_lock<mutex> guard(wakeLock);
+            while (!wake.wait_for(guard, interval, [this] { return stopping; })) {
+                guard.unlock();
+                runPass();
+                guard.lock();
+            }
+        });
+    }
+
+    void stop() {
+        {
+            lock_guard<mutex> guard(wakeLock);
+            stopping = true;
         }
+        wake.notify_all();
+        if (worker.joinable()) worker.join();
+    }
+
+    // Keep passes from running while the returned lock is held
+    unique_lock<mutex> holdPasses() {
+        return unique_lock<mutex>(passLock);
+    }
+
+    // Merge demand and reprice now; returns how many prices changed
+    size_t runPass() {
+        lock_guard<mutex> guard(passLock);
+        inventory.checkExpiry();
+        tracker.merge();
+        tracker.forEachRate(DemandTracker::HOUR_WINDOW, [&](int productID, double perHour) {
+            inventory.setLiveDemand(productID, (int)lround(perHour));
+        });
+        size_t repriced = inventory.applyDynamicPricing(
+            promotions.compiledRules(inventory.activeSeason(), inventory.activePromoCode()));
+        passes++;
+        lastRepriced = repriced;
+        return repriced;
+    }
+
+    const DemandTracker& demand() const {
+        return tracker;
+    }
+
+    void displayStatus() const {
+        cout << "\n--- Dynamic Pricing ---\n";
+        cout << "Passes Run: " << passes.load() << ", Products With Live Demand: " << tracker.trackedProducts()
+             << ", Repriced Last Pass: " << lastRepriced.load() << "\n";
+    }
+};
+
+// Membership Tiers, lowest first
+enum MembershipTier : uint8_t { BRONZE, SILVER, GOLD, PLATINUM, TIER_COUNT };
+
+static const char* tierName(MembershipTier tier) {
+    static const char* const names[TIER_COUNT] = {"Bronze", "Silver", "Gold", "Platinum"};
+    return names[tier];
+}
+
+// Customer Profile Class
+class CustomerProfile {
+public:
+    int customerID;
+    string name;
+    int rewardPoints;
+    MembershipTier tier;
+    uint32_t tierSlot;  // Position in LoyaltyProgram's member list for the tier
+
+    CustomerProfile(int customerID, string name, int rewardPoints)
+        : customerID(customerID), name(name), rewardPoints(rewardPoints), tier(BRONZE), tierSlot(0) {
+        updateMembershipLevel();
     }
 
-    // Apply Seasonal Discounts
-    void applySeasonalDiscount(PromotionNode& product, const string& season) {
-        if (season == "Summer" && product.category == "Drinks") {
-            product.price *= 0.85; // 15% off on drinks in summer
-            cout << "Seasonal discount applied: New price for " << product.name << " is $" << product.price << endl;
-        } else if (season == "Winter" && product.category == "Heaters") {
-            product.price *= 0.80; // 20% off on heaters in winter
-            cout << "Seasonal discount applied: New price for " << product.name << " is $" << product.price << endl;
+    const char* membershipLevel() const { return tierName(tier); }
+
+    // Update Membership Level Based on Reward Points
+    void updateMembershipLevel() {
+        if (rewardPoints >= 500) {
+            tier = PLATINUM;
+        } else if (rewardPoints >= 300) {
+            tier = GOLD;
+        } else if (rewardPoints >= 100) {
+            tier = SILVER;
         } else {
-            cout << "No seasonal discount applied for " << product.name << ".\n";
+            tier = BRONZE;
+        }
+    }
+};
+
+// Loyalty Program Class
+// Profiles are kept in join order with a hash index by customer ID, plus one member list
+// per tier maintained as points change, so lookups and tier campaigns never scan everyone.
+class LoyaltyProgram {
+private:
+    deque<CustomerProfile> customerProfiles;       // Join order; addresses stay stable
+    unordered_map<int, uint32_t> profileByID;      // Customer ID -> index in customerProfiles
+    vector<uint32_t> tierMembers[TIER_COUNT];      // Profile indices per tier, unordered
+    WriteAheadLog* journal = nullptr;              // Mutation log, if attached
+
+    void joinTier(uint32_t index) {
+        CustomerProfile& profile = customerProfiles[index];
+        vector<uint32_t>& members = tierMembers[profile.tier];
+        profile.tierSlot = (uint32_t)members.size();
+        members.push_back(index);
+    }
+
+    void leaveTier(uint32_t index) {
+        CustomerProfile& profile = customerProfiles[index];
+        vector<uint32_t>& members = tierMembers[profile.tier];
+        uint32_t moved = members.back();
+        members[profile.tierSlot] = moved;
+        customerProfiles[moved].tierSlot = profile.tierSlot;
+        members.pop_back();
+    }
+
+    CustomerProfile* insertProfile(int customerID, const string& name, int rewardPoints) {
+        uint32_t index = (uint32_t)customerProfiles.size();
+        if (!profileByID.emplace(customerID, index).second) return nullptr;
+        customerProfiles.push_back(CustomerProfile(customerID, name, rewardPoints));
+        joinTier(index);
+        return &customerProfiles.back();
+    }
+
+    CustomerProfile* findProfile(int customerID) {
+        auto found = profileByID.find(customerID);
+        return found == profileByID.end() ? nullptr : &customerProfiles[found->second];
+    }
+
+public:
+    // Record every subsequent profile change in the log (nullptr to stop)
+    void attachLog(WriteAheadLog* log) {
+        journal = log;
+    }
+
+    // Pre-size for count customers
+    void reserveCustomers(size_t count) {
+        profileByID.reserve(count);
+    }
+
+    // Add New Customer Profile
+    void addCustomerProfile(int customerID, string name) {
+        if (!insertProfile(customerID, name, 0)) {
+            cout << "Customer with ID " << customerID << " already exists.\n";
+            return;
+        }
+        if (journal) {
+            SnapshotBuffer record;
+            record.put<int32_t>(customerID);
+            record.putString(name);
+            journal->append(WriteAheadLog::ADD_CUSTOMER, record);
+            journal->commit();
+        }
+        cout << "Customer profile added: " << name << " (ID: " << customerID << ")\n";
+    }
+
+    // Write every customer profile to a snapshot section
+    void writeSnapshot(SnapshotBuffer& out) const {
+        out.put<uint64_t>(customerProfiles.size());
+        for (const auto& profile : customerProfiles) {
+            out.put<int32_t>(profile.customerID);
+            out.put<int32_t>(profile.rewardPoints);
+            out.putString(profile.name);
+        }
+    }
+
+    // Restore customer profiles from a snapshot section; returns false on truncated data
+    bool readSnapshot(SnapshotReader& in) {
+        uint64_t count;
+        if (!in.get(count)) return false;
+        reserveCustomers(customerProfiles.size() + count);
+        for (uint64_t i = 0; i < count; i++) {
+            int32_t customerID, rewardPoints;
+            string name;
+            if (!in.get(customerID) || !in.get(rewardPoints) || !in.getString(name)) return false;
+            insertProfile(customerID, name, rewardPoints);
         }
+        return true;
     }
 
-    // Apply Promotional Code
-    void applyPromoCode(PromotionNode& product, const string& promoCode) {
-        if (promoCodes.find(promoCode) != promoCodes.end()) {
-            double discountRate = promoCodes[promoCode];
-            product.price *= (1 - discountRate);
-            cout << "Promo code applied: New price for " << product.name << " is $" << product.price << endl;
+    // Re-apply a logged profile change during recovery; returns false on a malformed record
+    bool applyLogRecord(WriteAheadLog::RecordType type, SnapshotReader& in) {
+        int32_t customerID;
+        if (!in.get(customerID)) return false;
+        if (type == WriteAheadLog::ADD_CUSTOMER) {
+            string name;
+            if (!in.getString(name)) return false;
+            addCustomerProfile(customerID, name);
         } else {
-            cout << "Invalid promo code: " << promoCode << endl;
+            int32_t points;
+            if (!in.get(points)) return false;
+            updateRewardPoints(customerID, points);
         }
+        return true;
     }
-};
-
-// Customer Profile Class
-class CustomerProfile {
-public:
-    int customerID;
-    string name;
-    int rewardPoints;
-    string membershipLevel;
 
-    CustomerProfile(int customerID, string name, int rewardPoints)
-        : customerID(customerID), name(name), rewardPoints(rewardPoints) {
-        updateMembershipLevel();
+    bool hasCustomer(int customerID) const {
+        return profileByID.count(customerID) != 0;
     }
 
-    // Update Membership Level Based on Reward Points
-    void updateMembershipLevel() {
-        if (rewardPoints >= 500) {
-            membershipLevel = "Platinum";
-        } else if (rewardPoints >= 300) {
-            membershipLevel = "Gold";
-        } else if (rewardPoints >= 100) {
-            membershipLevel = "Silver";
-        } else {
-            membershipLevel = "Bronze";
-        }
+    size_t memberCount(MembershipTier tier) const {
+        return tierMembers[tier].size();
     }
-};
-
-// Loyalty Program Class
-class LoyaltyProgram {
-private:
-    list<CustomerProfile> customerProfiles; // Linked list to store customer profiles
 
-public:
-    // Add New Customer Profile
-    void addCustomerProfile(int customerID, string name) {
-        customerProfiles.push_back(CustomerProfile(customerID, name, 0));
-        cout << "Customer profile added: " << name << " (ID: " << customerID << ")\n";
+    // Visit every member of one tier (in no particular order)
+    void forEachMember(MembershipTier tier, const function<void(const CustomerProfile&)>& visit) const {
+        for (uint32_t index : tierMembers[tier]) visit(customerProfiles[index]);
     }
 
     // Update Reward Points
     void updateRewardPoints(int customerID, int points) {
-        for (auto& profile : customerProfiles) {
-            if (profile.customerID == customerID) {
-                profile.rewardPoints += points;
-                profile.updateMembershipLevel();
-                cout << "Updated reward points for " << profile.name
-                     << ". Total Points: " << profile.rewardPoints
-                     << ", Membership Level: " << profile.membershipLevel << "\n";
-                return;
-            }
+        auto found = profileByID.find(customerID);
+        if (found == profileByID.end()) {
+            cout << "Customer with ID " << customerID << " not found.\n";
+            return;
         }
-        cout << "Customer with ID " << customerID << " not found.\n";
+        uint32_t index = found->second;
+        CustomerProfile& profile = customerProfiles[index];
+        MembershipTier previous = profile.tier;
+        profile.rewardPoints += points;
+        profile.updateMembershipLevel();
+        if (profile.tier != previous) {
+            MembershipTier current = profile.tier;
+            profile.tier = previous;
+            leaveTier(index);
+            profile.tier = current;
+            joinTier(index);
+        }
+        if (journal) {
+            SnapshotBuffer record;
+            record.put<int32_t>(customerID);
+            record.put<int32_t>(points);
+            journal->append(WriteAheadLog::UPDATE_REWARD_POINTS, record);
+            journal->commit();
+        }
+        cout << "Updated reward points for " << profile.name
+             << ". Total Points: " << profile.rewardPoints
+             << ", Membership Level: " << profile.membershipLevel() << "\n";
     }
 
     // Display All Customer Profiles
@@ -576,7 +5739,7 @@ public:
             cout << "Customer ID: " << profile.customerID
                  << ", Name: " << profile.name
                  << ", Reward Points: " << profile.rewardPoints
-                 << ", Membership Level: " << profile.membershipLevel << "\n";
+                 << ", Membership Level: " << profile.membershipLevel() << "\n";
         }
     }
 
@@ -587,27 +5750,186 @@ public:
             return;
         }
 
+        static const char* const offers[TIER_COUNT] = {nullptr, "10% off", "15% off", "20% off"};
         cout << "\n--- Exclusive Offers ---\n";
-        for (const auto& profile : customerProfiles) {
-            if (profile.membershipLevel == "Platinum") {
-                cout << profile.name << ": 20% off on all purchases.\n";
-            } else if (profile.membershipLevel == "Gold") {
-                cout << profile.name << ": 15% off on all purchases.\n";
-            } else if (profile.membershipLevel == "Silver") {
-                cout << profile.name << ": 10% off on all purchases.\n";
+        for (int tier = PLATINUM; tier > BRONZE; tier--) {
+            forEachMember((MembershipTier)tier, [&](const CustomerProfile& profile) {
+                cout << profile.name << ": " << offers[tier] << " on all purchases.\n";
+            });
+        }
+    }
+};
+// Store Snapshot Class
+// Versioned on-disk image of inventory, pending orders and loyalty profiles.
+// Layout: header (magic, version, log sequence, section count) followed by tagged,
+// length-prefixed sections. The log sequence is the last journal record the snapshot covers.
+class StoreSnapshot {
+private:
+    static constexpr char MAGIC[8] = {'S', 'M', 'S', 'S', 'N', 'A', 'P', '\0'};
+    static constexpr uint32_t VERSION = 6;  // 3: amounts are int64 cents; 4: absolute expiry days;
+                                            // 5: fixed-width inventory rows; 6: order lanes
+
+    enum SectionTag : uint32_t {
+        INVENTORY_SECTION = 1,
+        ORDERS_SECTION = 2,
+        LOYALTY_SECTION = 3
+    };
+
+    static bool writeSection(FILE* out, uint32_t tag, const SnapshotBuffer& section) {
+        uint64_t length = section.bytes.size();
+        return fwrite(&tag, 1, sizeof(tag), out) == sizeof(tag) &&
+               fwrite(&length, 1, sizeof(length), out) == sizeof(length) &&
+               fwrite(section.bytes.data(), 1, length, out) == length;
+    }
+
+    // Flush and fsync the temporary file so its contents are durable before the rename
+    static bool writeTemp(const string& tempPath, uint64_t logSequence, const SnapshotBuffer& inventorySection,
+                          const SnapshotBuffer& ordersSection, const SnapshotBuffer& loyaltySection) {
+        FILE* out = fopen(tempPath.c_str(), "wb");
+        if (!out) return false;
+        uint32_t sectionCount = 3;
+        bool ok = fwrite(MAGIC, 1, sizeof(MAGIC), out) == sizeof(MAGIC) &&
+                  fwrite(&VERSION, 1, sizeof(VERSION), out) == sizeof(VERSION) &&
+                  fwrite(&logSequence, 1, sizeof(logSequence), out) == sizeof(logSequence) &&
+                  fwrite(&sectionCount, 1, sizeof(sectionCount), out) == sizeof(sectionCount) &&
+                  writeSection(out, INVENTORY_SECTION, inventorySection) &&
+                  writeSection(out, ORDERS_SECTION, ordersSection) &&
+                  writeSection(out, LOYALTY_SECTION, loyaltySection) && fflush(out) == 0;
+#ifdef SMS_POSIX_IO
+        ok = ok && fsync(fileno(out)) == 0;
+#endif
+        return fclose(out) == 0 && ok;
+    }
+
+    // Make the rename itself durable by fsyncing the directory that holds the snapshot
+    static bool syncDirectory(const string& path) {
+#ifdef SMS_POSIX_IO
+        string directory = filesystem::path(path).parent_path().string();
+        int fd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY);
+        if (fd < 0) return false;
+        bool ok = fsync(fd) == 0;
+        return close(fd) == 0 && ok;
+#else
+        (void)path;
+        return true;
+#endif
+    }
+
+public:
+    // Write to a temporary file and rename it over the old snapshot, so a crash never leaves a torn file.
+    // Returns true only once the new snapshot is durable, so the caller may then truncate the journal.
+    static bool save(const string& path, uint64_t logSequence, const InventoryManagement& inventory,
+                     CheckoutAndOrderManager& orders, const LoyaltyProgram& loyalty) {
+        SnapshotBuffer inventorySection, ordersSection, loyaltySection;
+        inventory.writeSnapshot(inventorySection);
+        orders.writeSnapshot(ordersSection);
+        loyalty.writeSnapshot(loyaltySection);
+
+        string tempPath = path + ".tmp";
+        if (!writeTemp(tempPath, logSequence, inventorySection, ordersSection, loyaltySection)) {
+            remove(tempPath.c_str());
+            return false;
+        }
+        return rename(tempPath.c_str(), path.c_str()) == 0 && syncDirectory(path);
+    }
+
+    // Load a snapshot into empty managers; unknown sections are skipped
+    static bool load(const string& path, uint64_t& logSequence, InventoryManagement& inventory,
+                     CheckoutAndOrderManager& orders, LoyaltyProgram& loyalty) {
+        MappedFile file;
+        if (!file.open(path)) return false;
+
+        SnapshotReader in(file.data(), file.size());
+        char magic[8];
+        uint32_t version = 0, sectionCount = 0;
+        if (!in.getBytes(magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+            cout << "Snapshot " << path << " is not a supermarket snapshot.\n";
+            return false;
+        }
+        if (!in.get(version) || version != VERSION) {
+            cout << "Snapshot " << path << " has unsupported version " << version << ".\n";
+            return false;
+        }
+        if (!in.get(logSequence) || !in.get(sectionCount)) return false;
+
+        for (uint32_t i = 0; i < sectionCount; i++) {
+            uint32_t tag;
+            uint64_t length;
+            SnapshotReader section(nullptr, 0);
+            if (!in.get(tag) || !in.get(length) || !in.sub(length, section)) {
+                cout << "Snapshot " << path << " is truncated.\n";
+                return false;
+            }
+            bool ok = true;
+            if (tag == INVENTORY_SECTION) {
+                ok = inventory.readSnapshot(section);
+            } else if (tag == ORDERS_SECTION) {
+                ok = orders.readSnapshot(section);
+            } else if (tag == LOYALTY_SECTION) {
+                ok = loyalty.readSnapshot(section);
+            }
+            if (!ok) {
+                cout << "Snapshot " << path << " has a corrupt section (tag " << tag << ").\n";
+                return false;
             }
         }
+        return true;
+    }
+};
+
+// Store Recovery Class
+// Rebuilds the store after a restart: latest snapshot, then the journal written since
+class StoreRecovery {
+public:
+    // Replays journal records newer than logSequence into the managers with console output
+    // muted. Updates logSequence and returns the number of records applied.
+    static size_t replayLog(const string& path, uint64_t& logSequence, uintmax_t& validLength,
+                            InventoryManagement& inventory, CheckoutAndOrderManager& orders, LoyaltyProgram& loyalty) {
+        size_t applied = 0;
+        streambuf* console = cout.rdbuf(nullptr);
+        logSequence = WriteAheadLog::replay(path, logSequence, validLength,
+            [&](WriteAheadLog::RecordType type, SnapshotReader& in) {
+                bool ok = false;
+                switch (type) {
+                    case WriteAheadLog::ADD_PRODUCT:
+                    case WriteAheadLog::UPDATE_PRODUCT:
+                    case WriteAheadLog::REMOVE_PRODUCT:
+                    case WriteAheadLog::CATEGORIZE_PRODUCT:
+                    case WriteAheadLog::SET_PROMOTION:
+                        ok = inventory.applyLogRecord(type, in);
+                        break;
+                    case WriteAheadLog::CHECKOUT:
+                    case WriteAheadLog::FULFILL_ORDER:
+                        ok = orders.applyLogRecord(type, in);
+                        break;
+                    case WriteAheadLog::ADD_CUSTOMER:
+                    case WriteAheadLog::UPDATE_REWARD_POINTS:
+                        ok = loyalty.applyLogRecord(type, in);
+                        break;
+                }
+                if (ok) applied++;
+                return ok;
+            });
+        cout.rdbuf(console);
+        cout.clear();
+        return applied;
     }
 };
+
 class AdminWorkflow {
 private:
     InventoryManagement& inventoryManager;
     AnalyticsAndReporting& analytics;
     PromotionsAndDiscounts& promotions;
+    CheckoutAndOrderManager& orderManager;
+    DynamicPricingScheduler& pricingScheduler;
+    StoreNetwork& storeNetwork;
 
 public:
-    AdminWorkflow(InventoryManagement& inventory, AnalyticsAndReporting& analytics, PromotionsAndDiscounts& promotions)
-        : inventoryManager(inventory), analytics(analytics), promotions(promotions) {}
+    AdminWorkflow(InventoryManagement& inventory, AnalyticsAndReporting& analytics, PromotionsAndDiscounts& promotions,
+                  CheckoutAndOrderManager& orderManager, DynamicPricingScheduler& pricingScheduler, StoreNetwork& storeNetwork)
+        : inventoryManager(inventory), analytics(analytics), promotions(promotions), orderManager(orderManager),
+          pricingScheduler(pricingScheduler), storeNetwork(storeNetwork) {}
 
     void start() {
         int choice;
@@ -619,16 +5941,31 @@ public:
             cout << "4. Categorize Product\n";
             cout << "5. Search Product\n";
             cout << "6. Generate Inventory Report\n";
-            cout << "7. Apply Dynamic Pricing\n";
+            cout << "7. Apply Promotions to Catalog\n";
             cout << "8. Display System Logs\n";
+            cout << "9. Search Products by ID Range\n";
+            cout << "10. Type-ahead Product Search\n";
+            cout << "11. Import Catalog (CSV/TSV)\n";
+            cout << "12. Fulfill Pending Orders\n";
+            cout << "13. Load Promotion Rules\n";
+            cout << "14. Import Promo Codes\n";
+            cout << "15. Run Dynamic Pricing Now\n";
+            cout << "16. Sales Reports\n";
+            cout << "17. Low Stock and Best Sellers\n";
+            cout << "18. Stock Alerts and Reorder Suggestions\n";
+            cout << "19. Set Low Stock Threshold\n";
+            cout << "20. Add Chain Store from Catalog\n";
+            cout << "21. Chain-wide Stock of Product\n";
+            cout << "22. Chain-wide Category Report\n";
             cout << "0. Logout\n";
             cout << "Enter your choice: ";
             cin >> choice;
 
+            auto passGuard = pricingScheduler.holdPasses();  // No repricing mid-action
             switch (choice) {
                 case 1: {
                     int ID, quantity, expire, discount, demand;
-                    double sellPrice, buyPrice;
+                    Money sellPrice, buyPrice;
                     string name, category, supplierName;
                     cout << "Enter product details:\n";
                     cout << "ID: "; cin >> ID;
@@ -641,38 +5978,38 @@ public:
                     cout << "Supplier Name: "; cin >> supplierName;
                     cout << "Discount (%): "; cin >> discount;
                     cout << "Demand: "; cin >> demand;
-                    inventoryManager.addProduct(ID, quantity, expire, discount, sellPrice, buyPrice, name, category, supplierName, demand);
-                    analytics.logOperation("Product added: " + name);
+                    inventoryManager.addProduct(ID, quantity, StockAlerts::today() + expire, discount, sellPrice, buyPrice, name, category, supplierName, demand);
+                    analytics.logOperation(OperationLog::PRODUCT_ADDED, ID);
                     break;
                 }
                 case 2: {
-                    int ID, quantity, discount;
-                    double sellPrice, buyPrice;
+                    int ID, quantity, expire;
+                    Money sellPrice, buyPrice;
                     string name, category, supplierName;
                     cout << "Enter product ID to update: "; cin >> ID;
                     cout << "New Name: "; cin >> name;
                     cout << "New Category: "; cin >> category;
                     cout << "New Quantity: "; cin >> quantity;
-                    cout << "New Expiry (days): "; cin >> discount;
+                    cout << "New Expiry (days): "; cin >> expire;
                     cout << "New Sell Price: "; cin >> sellPrice;
                     cout << "New Buy Price: "; cin >> buyPrice;
                     cout << "New Supplier Name: "; cin >> supplierName;
-                    inventoryManager.updateProduct(ID, name, category, quantity, discount, 0, sellPrice, buyPrice, supplierName);
-                    analytics.logOperation("Product updated: " + name);
+                    inventoryManager.updateProduct(ID, name, category, quantity, expire ? StockAlerts::today() + expire : 0, 0, sellPrice, buyPrice, supplierName);
+                    analytics.logOperation(OperationLog::PRODUCT_UPDATED, ID);
                     break;
                 }
                 case 3: {
                     int ID;
                     cout << "Enter product ID to remove: "; cin >> ID;
                     inventoryManager.removeProduct(ID);
-                    analytics.logOperation("Product removed with ID: " + to_string(ID));
+                    analytics.logOperation(OperationLog::PRODUCT_REMOVED, ID);
                     break;
                 }
                 case 4: {
                     int ID;
                     cout << "Enter product ID to categorize: "; cin >> ID;
                     inventoryManager.categorizeProduct(ID);
-                    analytics.logOperation("Product categorized with ID: " + to_string(ID));
+                    analytics.logOperation(OperationLog::PRODUCT_CATEGORIZED, ID);
                     break;
                 }
                 case 5: {
@@ -682,17 +6019,207 @@ public:
                     inventoryManager.searchProduct(0, name, category);
                     break;
                 }
-                case 6:
-                    inventoryManager.generateReport();
+                case 6: {
+                    int threshold, expiryWindow;
+                    cout << "Low stock threshold: "; cin >> threshold;
+                    cout << "Expiry window (days): "; cin >> expiryWindow;
+                    inventoryManager.generateReport(threshold, expiryWindow);
                     break;
+                }
                 case 7: {
-                    PromotionNode product(1, "Sample Product", "Category", 100.0, 50, 0);
-                    promotions.applyDynamicPricing(product, 60);
+                    string season, promoCode;
+                    cout << "Season (- for none): "; cin >> season;
+                    cout << "Promo code (- for none): "; cin >> promoCode;
+                    if (season == "-") season.clear();
+                    if (promoCode == "-") promoCode.clear();
+                    inventoryManager.setActivePromotion(season, promoCode);
+                    passGuard.unlock();
+                    auto started = chrono::steady_clock::now();
+                    size_t repriced = pricingScheduler.runPass();
+                    auto elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+                    cout << repriced << " products repriced in " << elapsed << " ms.\n";
+                    analytics.logOperation(OperationLog::CATALOG_REPRICED, 0, (int64_t)repriced);
                     break;
                 }
                 case 8:
                     analytics.displaySystemLogs();
                     break;
+                case 9: {
+                    int lowID, highID;
+                    cout << "Enter lowest ID: "; cin >> lowID;
+                    cout << "Enter highest ID: "; cin >> highID;
+                    inventoryManager.searchProductRange(lowID, highID);
+                    break;
+                }
+                case 10: {
+                    string query;
+                    cout << "Enter product name or prefix: "; cin.ignore(); getline(cin, query);
+                    inventoryManager.typeAheadSearch(query);
+                    break;
+                }
+                case 11: {
+                    string path;
+                    cout << "Enter catalog file path: "; cin.ignore(); getline(cin, path);
+                    CatalogImporter importer;
+                    CatalogImporter::Result result = importer.importFile(path, inventoryManager);
+                    cout << "Imported " << result.imported << " products, rejected " << result.rejected << " rows.\n";
+                    analytics.logOperation(OperationLog::CATALOG_IMPORTED, 0, (int64_t)result.imported);
+                    break;
+                }
+                case 12: {
+                    long long workerThreads = 0;
+                    size_t maxWorkers = FulfillmentScheduler::maxWorkers();
+                    cout << "Number of workers (1-" << maxWorkers << "): "; cin >> workerThreads;
+                    if (workerThreads < 1 || workerThreads > (long long)maxWorkers) {
+                        cout << "Invalid number of workers.\n";
+                        break;
+                    }
+                    mutex outputLock;
+                    FulfillmentScheduler scheduler(orderManager, [&](const FulfillmentScheduler::Completion& done) {
+                        lock_guard<mutex> guard(outputLock);
+                        cout << "Order " << done.orderID << " fulfilled by worker " << done.worker
+                             << " (Total Price: $" << done.totalPrice << ")\n";
+                    });
+                    size_t pending = orderManager.pendingCount();
+                    scheduler.start((size_t)workerThreads);
+                    scheduler.stop();
+                    scheduler.displayMetrics();
+                    analytics.logOperation(OperationLog::ORDERS_FULFILLED, 0, (int64_t)pending);
+                    break;
+                }
+                case 13: {
+                    string path;
+                    cout << "Rules file path: "; cin >> path;
+                    if (promotions.loadRules(path)) analytics.logOperation(OperationLog::RULES_LOADED);
+                    break;
+                }
+                case 14: {
+                    string path;
+                    cout << "Promo code file path: "; cin >> path;
+                    size_t added = promotions.codeStore().loadCodes(path);
+                    analytics.logOperation(OperationLog::PROMO_CODES_IMPORTED, 0, (int64_t)added);
+                    break;
+                }
+                case 15: {
+                    passGuard.unlock();
+                    size_t repriced = pricingScheduler.runPass();
+                    cout << repriced << " products repriced from live demand.\n";
+                    pricingScheduler.displayStatus();
+                    break;
+                }
+                case 16: {
+                    int window;
+                    cout << "Period (1. Last Hour, 2. Last 24 Hours, 3. Last 30 Days): "; cin >> window;
+                    if (window < 1 || window > SalesAggregator::WINDOW_COUNT) {
+                        cout << "Invalid period.\n";
+                        break;
+                    }
+                    analytics.generateSalesReportByProduct((SalesAggregator::Window)(window - 1));
+                    analytics.generateSalesReportByCategory((SalesAggregator::Window)(window - 1));
+                    break;
+                }
+                case 17: {
+                    size_t count;
+                    cout << "How many products: "; cin >> count;
+                    analytics.displayLowStockAlerts(count);
+                    analytics.displayBestSellers(count);
+                    break;
+                }
+                case 18: {
+                    inventoryManager.checkExpiry();
+                    vector<StockAlerts::Alert> alerts = inventoryManager.stockAlerts().recent(20);
+                    cout << "\n--- Recent Stock Alerts ---\n";
+                    if (alerts.empty()) cout << "No alerts.\n";
+                    for (const auto& alert : alerts) {
+                        if (alert.kind == StockAlerts::LOW_STOCK) {
+                            cout << "Low stock: " << alert.name << " (ID " << alert.productID << ") down to " << alert.value << "\n";
+                        } else {
+                            cout << "Expiring: " << alert.name << " (ID " << alert.productID << ") in " << alert.value << " days\n";
+                        }
+                    }
+                    const DemandTracker& demand = pricingScheduler.demand();
+                    auto suggestions = inventoryManager.reorderSuggestions(
+                        [&](int productID) { return demand.ratePerHour(productID, DemandTracker::DAY_WINDOW) * 24; });
+                    cout << "\n--- Reorder Suggestions ---\n";
+                    if (suggestions.empty()) cout << "Nothing to reorder.\n";
+                    for (const auto& supplier : suggestions) {
+                        cout << "Supplier: " << (supplier.first.empty() ? "(none)" : supplier.first) << "\n";
+                        for (const auto& line : supplier.second) {
+                            cout << "  " << line.item->name << " (ID " << line.item->ID << "): order " << line.quantity
+                                 << " (on hand " << line.item->quantity << ", threshold " << line.threshold << ")\n";
+                        }
+                    }
+                    break;
+                }
+                case 19: {
+                    int scope, threshold;
+                    cout << "Apply to (1. Product, 2. Category, 3. Default): "; cin >> scope;
+                    if (scope == 1) {
+                        int ID;
+                        cout << "Product ID: "; cin >> ID;
+                        cout << "Threshold: "; cin >> threshold;
+                        inventoryManager.setLowStockThreshold(ID, threshold);
+                    } else if (scope == 2) {
+                        string category;
+                        cout << "Category: "; cin >> category;
+                        cout << "Threshold: "; cin >> threshold;
+                        inventoryManager.setCategoryLowStockThreshold(category, threshold);
+                    } else if (scope == 3) {
+                        cout << "Threshold: "; cin >> threshold;
+                        inventoryManager.setDefaultLowStockThreshold(threshold);
+                    } else {
+                        cout << "Invalid choice.\n";
+                        break;
+                    }
+                    cout << "Threshold updated.\n";
+                    break;
+                }
+                case 20: {
+                    int storeID;
+                    string path;
+                    cout << "Store ID: "; cin >> storeID;
+                    cout << "Catalog file path: "; cin.ignore(); getline(cin, path);
+                    InventoryManagement* store = storeNetwork.addStore(storeID);
+                    if (!store) {
+                        cout << "Store " << storeID << " already exists.\n";
+                        break;
+                    }
+                    CatalogImporter importer;
+                    CatalogImporter::Result result = importer.importFile(path, *store);
+                    cout << "Store " << storeID << ": imported " << result.imported << " products, rejected "
+                         << result.rejected << " rows.\n";
+                    break;
+                }
+                case 21: {
+                    int ID;
+                    cout << "Enter product ID: "; cin >> ID;
+                    auto started = chrono::steady_clock::now();
+                    vector<pair<int, int>> stock = storeNetwork.stockByStore(ID);
+                    auto elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+                    int64_t total = 0;
+                    cout << "\n--- Chain Stock of Product " << ID << " ---\n";
+                    for (const auto& entry : stock) {
+                        cout << "Store " << entry.first << ": " << entry.second << "\n";
+                        total += entry.second;
+                    }
+                    cout << "Total: " << total << " units in " << stock.size() << " of " << storeNetwork.storeCount()
+                         << " stores (" << elapsed << " ms).\n";
+                    break;
+                }
+                case 22: {
+                    auto started = chrono::steady_clock::now();
+                    map<string, StoreNetwork::CategoryTotals> report = storeNetwork.categoryReport();
+                    auto elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+                    cout << "\n--- Chain Category Report ---\n";
+                    for (const auto& entry : report) {
+                        cout << "Category: " << entry.first << ", Products: " << entry.second.products
+                             << ", Units: " << entry.second.units << ", Stock Value: $" << entry.second.stockValue
+                             << ", Stores: " << entry.second.stores << "\n";
+                    }
+                    cout << storeNetwork.storeCount() << " stores scanned on " << storeNetwork.threadCount()
+                         << " threads in " << elapsed << " ms.\n";
+                    break;
+                }
                 case 0:
                     cout << "Logged out successfully.\n";
                     break;
@@ -707,10 +6234,12 @@ private:
     ShoppingCart& shoppingCart;
     CheckoutAndOrderManager& orderManager;
     LoyaltyProgram& loyaltyProgram;
+    PromotionsAndDiscounts& promotions;
 
 public:
-    CustomerWorkflow(ShoppingCart& cart, CheckoutAndOrderManager& orderManager, LoyaltyProgram& loyaltyProgram)
-        : shoppingCart(cart), orderManager(orderManager), loyaltyProgram(loyaltyProgram) {}
+    CustomerWorkflow(ShoppingCart& cart, CheckoutAndOrderManager& orderManager, LoyaltyProgram& loyaltyProgram,
+                     PromotionsAndDiscounts& promotions)
+        : shoppingCart(cart), orderManager(orderManager), loyaltyProgram(loyaltyProgram), promotions(promotions) {}
 
     void start() {
         int choice;
@@ -724,6 +6253,8 @@ public:
             cout << "6. Checkout\n";
             cout << "7. View Loyalty Profile\n";
             cout << "8. Redeem Rewards\n";
+            cout << "9. Redo Last Action\n";
+            cout << "10. Apply Promo Code\n";
             cout << "0. Exit\n";
             cout << "Enter your choice: ";
             cin >> choice;
@@ -731,7 +6262,7 @@ public:
             switch (choice) {
                 case 1: {
                     int ID, quantity;
-                    double price;
+                    Money price;
                     string name;
                     cout << "Enter item details:\n";
                     cout << "ID: "; cin >> ID;
@@ -757,15 +6288,44 @@ public:
                 case 5:
                     shoppingCart.displayCart();
                     break;
-                case 6:
-                    orderManager.checkout(shoppingCart.cart);
+                case 6: {
+                    // Redeem the cart's promo code only as the order goes through
+                    string promoCode = shoppingCart.promoCode();
+                    if (!promoCode.empty()) {
+                        double discountRate;
+                        PromoCodeStore::Status status = promotions.redeemPromoCode(promoCode, discountRate);
+                        if (status != PromoCodeStore::VALID) {
+                            cout << "Promo code " << promoCode << " can no longer be used (" << PromoCodeStore::describe(status)
+                                 << "); it has been removed from the cart.\n";
+                            shoppingCart.setPromotion("", 0);
+                            break;
+                        }
+                    }
+                    if (!orderManager.checkout(shoppingCart) && !promoCode.empty()) promotions.refundPromoCode(promoCode);
                     break;
+                }
                 case 7:
                     loyaltyProgram.displayAllProfiles();
                     break;
                 case 8:
                     loyaltyProgram.provideExclusiveOffers();
                     break;
+                case 9:
+                    shoppingCart.redoLastAction();
+                    break;
+                case 10: {
+                    string promoCode;
+                    double discountRate;
+                    cout << "Enter promo code: "; cin >> promoCode;
+                    PromoCodeStore::Status status = promotions.findPromoCode(promoCode, discountRate);
+                    if (status == PromoCodeStore::VALID) {
+                        shoppingCart.setPromotion(promoCode, discountRate);
+                        cout << "Promo code applied to cart: " << promoCode << endl;
+                    } else {
+                        cout << "Invalid promo code: " << promoCode << " (" << PromoCodeStore::describe(status) << ")" << endl;
+                    }
+                    break;
+                }
                 case 0:
                     cout << "Thank you for using the system. Goodbye!\n";
                     break;
@@ -775,7 +6335,868 @@ public:
         } while (choice != 0);
     }
 };
-int main() {
+
+// Regression Checks Class
+// Self-contained checks run with --check. Each prints PASS or FAIL; run() returns the
+// process exit code.
+class RegressionChecks {
+private:
+    static bool report(const string& name, bool passed) {
+        cout << (passed ? "PASS " : "FAIL ") << name << "\n";
+        return passed;
+    }
+
+    // Re-applying a promotion (admin option 7) and running pricing passes must leave the
+    // list price alone and settle on one sell price
+    static bool promotionsDoNotCompound() {
+        InventoryManagement inventory;
+        PromotionsAndDiscounts promotions;
+        DemandTracker tracker;
+        DynamicPricingScheduler scheduler(tracker, inventory, promotions);
+        inventory.insertProduct(1, 10, StockAlerts::today() + 30, 0, Money::fromCents(1000), Money::fromCents(600), "Cola", "Drinks", "Acme", 60);
+
+        Money settled;
+        for (int round = 0; round < 3; round++) {
+            inventory.setActivePromotion("Summer", "");
+            scheduler.runPass();
+            scheduler.runPass();
+            const ItemNode* item = inventory.findProduct(1);
+            if (item->listPrice != Money::fromCents(1000)) return false;
+            if (round == 0) {
+                settled = item->sellPrice;
+            } else if (item->sellPrice != settled) {
+                return false;
+            }
+        }
+        return settled == Money::fromCents(1020);  // +20% high demand, then -15% summer drinks
+    }
+
+    // Changing a product's price between pricing passes sets its list price; the sell price
+    // keeps the active promotion instead of reverting to the new list price
+    static bool updateKeepsPromotion() {
+        InventoryManagement inventory;
+        PromotionsAndDiscounts promotions;
+        DemandTracker tracker;
+        DynamicPricingScheduler scheduler(tracker, inventory, promotions);
+        inventory.insertProduct(1, 10, StockAlerts::today() + 30, 0, Money::fromCents(1000), Money::fromCents(600), "Cola", "Drinks", "Acme", 60);
+        inventory.setActivePromotion("Summer", "");
+        scheduler.runPass();
+
+        streambuf* console = cout.rdbuf(nullptr);
+        inventory.updateProduct(1, "Cola", "Drinks", 0, 0, 0, Money::fromCents(2000));
+        cout.rdbuf(console);
+        const ItemNode* item = inventory.findProduct(1);
+        if (item->listPrice != Money::fromCents(2000) || item->sellPrice != Money::fromCents(2040)) return false;
+        return scheduler.runPass() == 0;  // The next pass agrees with the price already set
+    }
+
+    // A restart must not push expiry dates back: reloading a snapshot keeps the expiry day
+    static bool expiryDaySurvivesRestart() {
+        int64_t expiryDay = StockAlerts::today() - 3;  // Received days ago, already past due
+        InventoryManagement inventory;
+        inventory.insertProduct(1, 10, expiryDay, 0, Money::fromCents(1000), Money::fromCents(600), "Milk", "Dairy", "Acme", 0);
+
+        SnapshotBuffer image;
+        inventory.writeSnapshot(image);
+        InventoryManagement restarted;
+        SnapshotReader in(image.bytes.data(), image.bytes.size());
+        if (!restarted.readSnapshot(in)) return false;
+        const ItemNode* item = restarted.findProduct(1);
+        return item && item->expiryDay == expiryDay;
+    }
+
+    // A cart line with a zero or negative quantity must not reserve (or give back) stock,
+    // and must not let the rest of its cart through either
+    static bool nonPositiveQuantitiesRejected() {
+        InventoryManagement inventory;
+        inventory.insertProduct(1, 10, StockAlerts::today() + 30, 0, Money::fromCents(1000), Money::fromCents(600), "Cola", "Drinks", "Acme", 0);
+        inventory.insertProduct(2, 10, StockAlerts::today() + 30, 0, Money::fromCents(500), Money::fromCents(300), "Chips", "Snacks", "Acme", 0);
+
+        if (inventory.reserveStock({CartItem(1, "Cola", Money::fromCents(1000), -5, 0)}) != 1) return false;
+        if (inventory.reserveStock({CartItem(2, "Chips", Money::fromCents(500), 3, 0),
+                                    CartItem(1, "Cola", Money::fromCents(1000), 0, 0)}) != 1) return false;
+        if (inventory.findProduct(1)->quantity != 10 || inventory.findProduct(2)->quantity != 10) return false;
+        return inventory.reserveStock({CartItem(1, "Cola", Money::fromCents(1000), 4, 0)}) == 0 &&
+               inventory.findProduct(1)->quantity == 6;
+    }
+
+    // Pending orders keep the lane that placed them across a snapshot
+    static bool orderLanesSurviveRestart() {
+        CheckoutAndOrderManager orders;
+        int shortID;
+        orders.placeOrder({CartItem(1, "Cola", Money::fromCents(1000), 1, 0)}, 3, shortID);
+        orders.placeOrder({CartItem(2, "Tea", Money::fromCents(300), 2, 0)}, 40, shortID);
+
+        SnapshotBuffer image;
+        orders.writeSnapshot(image);
+        CheckoutAndOrderManager restarted;
+        SnapshotReader in(image.bytes.data(), image.bytes.size());
+        if (!restarted.readSnapshot(in)) return false;
+        vector<unsigned> lanes;
+        restarted.forEachPending([&](const Order& order) { lanes.push_back(order.lane); });
+        return lanes == vector<unsigned>{3, 40};
+    }
+
+    // Lanes 0 and 32 share a shard; an older order pushed after a newer one from the other
+    // lane must still come out first
+    static bool oldestOrderPopsFirst() {
+        ShardedOrderQueue queue;
+        queue.push(5, {}, Money::fromCents(100), 32);
+        queue.push(3, {}, Money::fromCents(100), 0);
+        queue.push(4, {}, Money::fromCents(100), 1);
+        vector<int> popped;
+        while (queue.popOldest([&](const Order& order) { popped.push_back(order.orderID); })) {
+        }
+        return popped == vector<int>{3, 4, 5};
+    }
+
+    // Every vector kernel set the CPU supports must agree exactly with the scalar loops
+    // (cent-valued doubles keep sums exact) on every length around the vector widths and
+    // on unaligned starts, so the tails and the main loops are both covered
+    static bool inventoryKernelsMatchScalar(string& isas) {
+        vector<InventoryKernelTable> tables = supportedInventoryKernels();
+        const InventoryKernelTable& scalar = tables.back();
+        const size_t maxLength = 1027, maxOffset = 3;
+        mt19937 random(5);
+        vector<int> quantity(maxLength + maxOffset), days(maxLength + maxOffset);
+        vector<double> sell(maxLength + maxOffset), buy(maxLength + maxOffset);
+        for (size_t i = 0; i < quantity.size(); i++) {
+            quantity[i] = (int)(random() % 2001) - 1000;
+            days[i] = (int)(random() % 200) - 100;
+            buy[i] = (double)(random() % 100000);
+            sell[i] = buy[i] + (double)(random() % 20000) - 5000;
+        }
+
+        bool passed = true;
+        for (size_t t = 0; t + 1 < tables.size(); t++) {
+            const InventoryKernelTable& kernels = tables[t];
+            isas += (isas.empty() ? "" : ", ") + string(kernels.isa);
+            vector<double> expected(maxLength), actual(maxLength);
+            for (size_t offset = 0; offset <= maxOffset; offset++) {
+                for (size_t n = 0; n <= maxLength; n = n < 40 ? n + 1 : n * 2 + 1) {
+                    const int* q = quantity.data() + offset;
+                    const int* d = days.data() + offset;
+                    const double* sp = sell.data() + offset;
+                    const double* bp = buy.data() + offset;
+                    int limit = (int)(n % 7) * 10 - 30;
+                    scalar.marginOnStock(sp, bp, q, expected.data(), n);
+                    kernels.marginOnStock(sp, bp, q, actual.data(), n);
+                    passed &= kernels.countAtMost(d, n, limit) == scalar.countAtMost(d, n, limit) &&
+                              kernels.weightedSum(q, bp, n) == scalar.weightedSum(q, bp, n) &&
+                              equal(actual.begin(), actual.begin() + n, expected.begin());
+                }
+            }
+        }
+        if (isas.empty()) isas = "scalar only";
+        return passed;
+    }
+
+    // Random inserts and erases into the AVL product tree and the open-addressing ID index,
+    // mirrored into std::map and std::unordered_map: first growing, then shrinking back, over
+    // a dense ID range (negative IDs included) so probe chains collide and wrap. Lookups,
+    // range scans, sizes and the tree's balance are compared every few hundred steps.
+    static bool productIndexesMatchStd() {
+        const int idRange = 4000, steps = 80000;
+        ObjectPool<ItemNode> pool;
+        unordered_map<int, ItemNode*> records;  // One record per ID, made on first use
+        auto record = [&](int ID) {
+            ItemNode*& item = records[ID];
+            if (!item) item = pool.create(ID, 1, 0, 0, Money(), Money(), "", "", "", 0);
+            return item;
+        };
+        ProductTree tree;
+        ProductIndex index;
+        map<int, ItemNode*> ordered;
+        unordered_map<int, ItemNode*> hashed;
+        mt19937 random(23);
+
+        bool passed = true;
+        for (int step = 1; step <= steps && passed; step++) {
+            int ID = (int)(random() % idRange) - idRange / 4;
+            bool growing = step <= steps / 2;
+            if (random() % 4 < (growing ? 3u : 1u)) {
+                ItemNode* item = record(ID);
+                bool fresh = ordered.emplace(ID, item).second;
+                hashed.emplace(ID, item);
+                passed = tree.insert(item) == fresh && index.insert(ID, item) == fresh;
+            } else {
+                bool present = ordered.erase(ID) != 0;
+                hashed.erase(ID);
+                passed = tree.erase(ID) == present && index.erase(ID) == present;
+            }
+            if (!passed || step % 500) continue;
+
+            passed = tree.size() == ordered.size() && index.size() == hashed.size() && tree.balanced();
+            for (int probe = -idRange / 4 - 1; passed && probe <= idRange; probe++) {
+                auto found = hashed.find(probe);
+                ItemNode* expected = found == hashed.end() ? nullptr : found->second;
+                passed = index.find(probe) == expected && tree.find(probe) == expected;
+            }
+            int low = (int)(random() % idRange) - idRange / 4;
+            int high = low + (int)(random() % (idRange / 2));
+            vector<int> scanned, expected;
+            tree.forEachInRange(low, high, [&](ItemNode* item) { scanned.push_back(item->ID); });
+            for (auto it = ordered.lower_bound(low); it != ordered.end() && it->first <= high; ++it) expected.push_back(it->first);
+            passed = passed && scanned == expected;
+        }
+        for (auto& entry : records) pool.destroy(entry.second);
+        return passed;
+    }
+
+    // The cart's lines equal expected slot for slot, every product ID from 1 to maxID maps
+    // to its line (or to none), and the incremental totals equal a from-scratch pricing
+    static bool cartMatches(const ShoppingCart& cart, const vector<CartItem>& expected, int maxID) {
+        if (cart.size() != expected.size()) return false;
+        CartPricing rebuilt;
+        for (size_t slot = 0; slot < expected.size(); slot++) {
+            const CartItem& line = cart.begin()[slot];
+            const CartItem& want = expected[slot];
+            if (line.ID != want.ID || line.quantity != want.quantity || line.price != want.price ||
+                line.discount != want.discount || cart.findLine(want.ID) != &line) {
+                return false;
+            }
+            rebuilt.addLine(want);
+        }
+        for (int ID = 1; ID <= maxID; ID++) {
+            bool present = any_of(expected.begin(), expected.end(), [&](const CartItem& line) { return line.ID == ID; });
+            if (present != (cart.findLine(ID) != nullptr)) return false;
+        }
+        return cart.totals().subtotal() == rebuilt.subtotal() && cart.totals().lineDiscounts() == rebuilt.lineDiscounts() &&
+               cart.totals().total() == rebuilt.total();
+    }
+
+    // Random adds, quantity changes, removals, undos and redos against a model that keeps
+    // whole copies of the cart on its undo and redo stacks
+    static bool cartHistoryMatchesModel() {
+        const int products = 8, steps = 2000;
+        ShoppingCart cart(steps);
+        vector<CartItem> model;
+        vector<vector<CartItem>> undone, redone;
+        mt19937 random(13);
+        auto change = [&](vector<CartItem> next) {
+            undone.push_back(model);
+            redone.clear();
+            model = std::move(next);
+        };
+
+        streambuf* console = cout.rdbuf(nullptr);
+        bool passed = true;
+        for (int step = 0; step < steps && passed; step++) {
+            int ID = 1 + (int)(random() % products);
+            auto line = find_if(model.begin(), model.end(), [&](const CartItem& item) { return item.ID == ID; });
+            switch (random() % 5) {
+                case 0: {
+                    int quantity = 1 + (int)(random() % 3);
+                    vector<CartItem> next = model;
+                    if (line != model.end()) {
+                        next[line - model.begin()].quantity += quantity;
+                    } else {
+                        next.push_back(CartItem(ID, "Item " + to_string(ID), Money::fromCents(99 * ID), quantity, ID % 3 * 5));
+                    }
+                    cart.addItem(ID, "Item " + to_string(ID), Money::fromCents(99 * ID), quantity, ID % 3 * 5);
+                    change(std::move(next));
+                    break;
+                }
+                case 1: {
+                    int quantity = 1 + (int)(random() % 5);
+                    cart.updateQuantity(ID, quantity);
+                    if (line == model.end()) break;  // Not in the cart: nothing recorded
+                    vector<CartItem> next = model;
+                    next[line - model.begin()].quantity = quantity;
+                    change(std::move(next));
+                    break;
+                }
+                case 2:
+                    cart.removeLastItem();
+                    if (!model.empty()) change(vector<CartItem>(model.begin(), model.end() - 1));
+                    break;
+                case 3:
+                    cart.undoLastAction();
+                    if (!undone.empty()) {
+                        redone.push_back(model);
+                        model = undone.back();
+                        undone.pop_back();
+                    }
+                    break;
+                case 4:
+                    cart.redoLastAction();
+                    if (!redone.empty()) {
+                        undone.push_back(model);
+                        model = redone.back();
+                        redone.pop_back();
+                    }
+                    break;
+            }
+            passed = cartMatches(cart, model, products);
+        }
+        cout.rdbuf(console);
+        return passed;
+    }
+
+    // A new action after an undo drops the undone action for good
+    static bool cartRedoClearedByNewAction() {
+        ShoppingCart cart;
+        CartItem bread(1, "Bread", Money::fromCents(250), 1, 0), jam(2, "Jam", Money::fromCents(475), 2, 10);
+        CartItem eggs(3, "Eggs", Money::fromCents(320), 1, 0);
+        streambuf* console = cout.rdbuf(nullptr);
+        cart.addItem(bread.ID, bread.name, bread.price, bread.quantity, bread.discount);
+        cart.addItem(jam.ID, jam.name, jam.price, jam.quantity, jam.discount);
+        cart.undoLastAction();
+        cart.addItem(eggs.ID, eggs.name, eggs.price, eggs.quantity, eggs.discount);
+        cart.redoLastAction();  // Must not bring the jam back
+        cout.rdbuf(console);
+        return cartMatches(cart, {bread, eggs}, 3);
+    }
+
+    // Undo and redo stepping across a slot that was emptied by a removal: the quantity
+    // change recorded against the line's slot must land on the restored line
+    static bool cartUndoAcrossRemovedSlot() {
+        ShoppingCart cart;
+        CartItem milk(7, "Milk", Money::fromCents(129), 1, 0), tea(9, "Tea", Money::fromCents(410), 1, 15);
+        streambuf* console = cout.rdbuf(nullptr);
+        cart.addItem(milk.ID, milk.name, milk.price, milk.quantity, milk.discount);
+        cart.addItem(tea.ID, tea.name, tea.price, tea.quantity, tea.discount);
+        cart.updateQuantity(tea.ID, 4);
+        cart.removeLastItem();
+        bool passed = cartMatches(cart, {milk}, 9);
+        cart.undoLastAction();  // Tea back in slot 1 with its new quantity
+        CartItem fourTea = tea;
+        fourTea.quantity = 4;
+        passed = passed && cartMatches(cart, {milk, fourTea}, 9);
+        cart.undoLastAction();  // Quantity change undone on the restored line
+        passed = passed && cartMatches(cart, {milk, tea}, 9);
+        cart.redoLastAction();
+        cart.redoLastAction();
+        passed = passed && cartMatches(cart, {milk}, 9);
+        cart.addItem(tea.ID, tea.name, tea.price, 2, tea.discount);  // The slot is reused by a new line
+        CartItem twoTea = tea;
+        twoTea.quantity = 2;
+        passed = passed && cartMatches(cart, {milk, twoTea}, 9);
+        cart.undoLastAction();
+        cout.rdbuf(console);
+        return passed && cartMatches(cart, {milk}, 9);
+    }
+
+    static int rewardPoints(const LoyaltyProgram& loyalty, int customerID) {
+        int points = -1;
+        for (int tier = BRONZE; tier < TIER_COUNT; tier++) {
+            loyalty.forEachMember((MembershipTier)tier, [&](const CustomerProfile& profile) {
+                if (profile.customerID == customerID) points = profile.rewardPoints;
+            });
+        }
+        return points;
+    }
+
+    // Journal one record of every kind on top of a snapshot, tear the last record as a crash
+    // mid-write would, then recover: every intact record is replayed, the torn one is not,
+    // and reopening the journal cuts the tail off so new records replay after the rest
+    static bool journalSurvivesTornTail() {
+        string snapshotPath = (filesystem::temp_directory_path() / "sms-check.snap").string();
+        string logPath = (filesystem::temp_directory_path() / "sms-check.wal").string();
+        remove(logPath.c_str());
+        streambuf* console = cout.rdbuf(nullptr);  // The journaled calls print as they go
+        int64_t expiryDay = StockAlerts::today() + 30;
+
+        uintmax_t tornLength, recordEnd;
+        {
+            InventoryManagement inventory;
+            CheckoutAndOrderManager orders;
+            LoyaltyProgram loyalty;
+            orders.attachInventory(&inventory);
+            inventory.insertProduct(1, 10, expiryDay, 0, Money::fromCents(1000), Money::fromCents(600), "Cola", "Drinks", "Acme", 0);
+            inventory.insertProduct(2, 5, expiryDay, 0, Money::fromCents(500), Money::fromCents(300), "Chips", "Snacks", "Acme", 0);
+            loyalty.addCustomerProfile(1, "Ann");
+            WriteAheadLog journal;
+            if (!StoreSnapshot::save(snapshotPath, 0, inventory, orders, loyalty) ||
+                !journal.open(logPath, WriteAheadLog::FSYNC_NONE, 64, 0, 0)) {
+                cout.rdbuf(console);
+                return false;
+            }
+            inventory.attachLog(&journal);
+            orders.attachLog(&journal);
+            loyalty.attachLog(&journal);
+
+            inventory.insertProduct(3, 8, expiryDay, 0, Money::fromCents(300), Money::fromCents(100), "Tea", "Drinks", "Acme", 0);
+            inventory.updateProduct(1, "Cola", "Drinks", 20, 0, 0, Money::fromCents(1200));
+            inventory.removeProduct(2);
+            inventory.categorizeProduct(3);
+            int shortID;
+            orders.placeOrder({CartItem(1, "Cola", Money::fromCents(1200), 4, 0), CartItem(3, "Tea", Money::fromCents(300), 2, 0)}, 0, shortID);
+            orders.placeOrder({CartItem(3, "Tea", Money::fromCents(300), 1, 0)}, 0, shortID);
+            orders.fulfillOrder();
+            loyalty.addCustomerProfile(2, "Ben");
+            loyalty.updateRewardPoints(1, 150);
+            journal.commit();
+            recordEnd = filesystem::file_size(logPath);
+            loyalty.updateRewardPoints(2, 40);  // The record the crash tears
+            journal.close();
+            tornLength = filesystem::file_size(logPath) - 5;
+            filesystem::resize_file(logPath, tornLength);
+        }
+
+        auto recover = [&](InventoryManagement& inventory, CheckoutAndOrderManager& orders, LoyaltyProgram& loyalty,
+                           uint64_t& sequence, uintmax_t& validLength) {
+            orders.attachInventory(&inventory);
+            if (!StoreSnapshot::load(snapshotPath, sequence, inventory, orders, loyalty)) return (size_t)0;
+            return StoreRecovery::replayLog(logPath, sequence, validLength, inventory, orders, loyalty);
+        };
+        auto stateMatches = [&](InventoryManagement& inventory, CheckoutAndOrderManager& orders, LoyaltyProgram& loyalty) {
+            const ItemNode* cola = inventory.findProduct(1);
+            const ItemNode* tea = inventory.findProduct(3);
+            return cola && cola->quantity == 16 && cola->listPrice == Money::fromCents(1200) &&
+                   !inventory.findProduct(2) && tea && tea->quantity == 5 && orders.pendingCount() == 1 &&
+                   rewardPoints(loyalty, 1) == 150;
+        };
+
+        bool passed;
+        {
+            InventoryManagement inventory;
+            CheckoutAndOrderManager orders;
+            LoyaltyProgram loyalty;
+            uint64_t sequence;
+            uintmax_t validLength;
+            passed = recover(inventory, orders, loyalty, sequence, validLength) == 9 && sequence == 9 &&
+                     validLength == recordEnd && stateMatches(inventory, orders, loyalty) &&
+                     rewardPoints(loyalty, 2) == 0;
+
+            // Resume the journal after the intact prefix, as startup does
+            WriteAheadLog journal;
+            passed = passed && journal.open(logPath, WriteAheadLog::FSYNC_NONE, 64, sequence, validLength) &&
+                     filesystem::file_size(logPath) == recordEnd;
+            loyalty.attachLog(&journal);
+            loyalty.updateRewardPoints(2, 40);
+        }
+        {
+            InventoryManagement inventory;
+            CheckoutAndOrderManager orders;
+            LoyaltyProgram loyalty;
+            uint64_t sequence;
+            uintmax_t validLength;
+            passed = passed && recover(inventory, orders, loyalty, sequence, validLength) == 10 &&
+                     stateMatches(inventory, orders, loyalty) && rewardPoints(loyalty, 2) == 40;
+        }
+        cout.rdbuf(console);
+        remove(snapshotPath.c_str());
+        remove(logPath.c_str());
+        return passed;
+    }
+
+    // Rows with negative quantities or prices are reported as malformed along with the
+    // other rejects; quoted fields may hold the delimiter and doubled quotes
+    static bool importRejectsMalformedRows() {
+        const char* file =
+            "ID,Name,Category,Buy Price,Sell Price,Quantity,Expire,Supplier Name,Discount,Demand\n"
+            "1,Cola,Drinks,0.60,1.00,10,30,Acme,0,5\n"
+            "2,\"Milk, whole\",Dairy,0.50,0.90,20,7,\"Farm \"\"Fresh\"\" Co\",0,3\n"
+            "3,Tea,Drinks,0.20,0.40,-5,30,Acme,0,1\n"
+            "4,Soap,Home,-1.00,2.00,5,30,Acme,0,1\n"
+            "5,Rice,Food,1.00,-2.00,5,30,Acme,0,1\n"
+            "6,\"Bread,Food,1,2,3,4,Acme,0,1\n"
+            "1,Cola,Drinks,0.60,1.00,10,30,Acme,0,5\n"
+            "7,\"Chips\",Snacks,0.30,0.50,0,30,Acme,0,2\r\n";
+        InventoryManagement inventory;
+        ostringstream output;
+        streambuf* console = cout.rdbuf(output.rdbuf());
+        CatalogImporter::Result result = CatalogImporter().importData(file, inventory);
+        cout.rdbuf(console);
+
+        const ItemNode* milk = inventory.findProduct(2);
+        return output.str() ==
+                   "Line 4: negative quantity -5\n"
+                   "Line 5: negative buy or sell price\n"
+                   "Line 6: negative buy or sell price\n"
+                   "Line 7: unterminated or misplaced quote\n"
+                   "Line 8: duplicate product ID 1\n" &&
+               result.imported == 3 && result.rejected == 5 && inventory.productCount() == 3 &&
+               inventory.findProduct(1) && inventory.findProduct(7) && inventory.findProduct(7)->quantity == 0 &&
+               milk && milk->name == "Milk, whole" && milk->supplierName == "Farm \"Fresh\" Co" &&
+               milk->sellPrice == Money::fromCents(90);
+    }
+
+    // A logged checkout the snapshot already covers finds its stock gone on replay: recovery
+    // must stop there instead of queueing the order a second time
+    static bool replayStopsOnMissingStock() {
+        string snapshotPath = (filesystem::temp_directory_path() / "sms-check-stock.snap").string();
+        string logPath = (filesystem::temp_directory_path() / "sms-check-stock.wal").string();
+        remove(logPath.c_str());
+        InventoryManagement inventory;
+        CheckoutAndOrderManager orders;
+        LoyaltyProgram loyalty;
+        orders.attachInventory(&inventory);
+        inventory.insertProduct(1, 2, StockAlerts::today() + 30, 0, Money::fromCents(1000), Money::fromCents(600), "Cola", "Drinks", "Acme", 0);
+        bool passed;
+        {
+            WriteAheadLog journal;
+            passed = journal.open(logPath, WriteAheadLog::FSYNC_NONE, 64, 0, 0);
+            orders.attachLog(&journal);
+            int shortID;
+            passed = passed && orders.placeOrder({CartItem(1, "Cola", Money::fromCents(1000), 2, 0)}, 0, shortID) != 0;
+            orders.attachLog(nullptr);
+        }
+        // Saved as if it covered no journal records, so replay sees the checkout again
+        passed = passed && StoreSnapshot::save(snapshotPath, 0, inventory, orders, loyalty);
+
+        InventoryManagement restored;
+        CheckoutAndOrderManager restoredOrders;
+        LoyaltyProgram restoredLoyalty;
+        restoredOrders.attachInventory(&restored);
+        uint64_t sequence;
+        uintmax_t validLength;
+        passed = passed && StoreSnapshot::load(snapshotPath, sequence, restored, restoredOrders, restoredLoyalty) &&
+                 StoreRecovery::replayLog(logPath, sequence, validLength, restored, restoredOrders, restoredLoyalty) == 0 &&
+                 sequence == 0 && restoredOrders.pendingCount() == 1 && restored.findProduct(1)->quantity == 0;
+        remove(snapshotPath.c_str());
+        remove(logPath.c_str());
+        return passed;
+    }
+
+public:
+    static int run() {
+        bool passed = true;
+        passed &= report("promotions do not compound", promotionsDoNotCompound());
+        passed &= report("update keeps promotion", updateKeepsPromotion());
+        passed &= report("expiry day survives restart", expiryDaySurvivesRestart());
+        passed &= report("non-positive quantities rejected", nonPositiveQuantitiesRejected());
+        passed &= report("order lanes survive restart", orderLanesSurviveRestart());
+        passed &= report("oldest order pops first", oldestOrderPopsFirst());
+        passed &= report("product tree and index match std containers", productIndexesMatchStd());
+        passed &= report("cart history matches model", cartHistoryMatchesModel());
+        passed &= report("cart redo cleared by new action", cartRedoClearedByNewAction());
+        passed &= report("cart undo across removed slot", cartUndoAcrossRemovedSlot());
+        string isas;
+        bool kernelsMatch = inventoryKernelsMatchScalar(isas);
+        passed &= report("inventory kernels match scalar (" + isas + ")", kernelsMatch);
+        passed &= report("journal survives a torn tail", journalSurvivesTornTail());
+        passed &= report("replay stops on missing stock", replayStopsOnMissingStock());
+        passed &= report("import rejects malformed rows", importRejectsMalformedRows());
+        return passed ? 0 : 1;
+    }
+};
+
+// Benchmarks Class
+// Timed runs of the hot and concurrent paths, selected with --bench. The numbers depend on
+// the machine; every run also checks its own results, and run() returns 1 if one is wrong.
+class Benchmarks {
+private:
+    static double secondsSince(chrono::steady_clock::time_point start) {
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+
+    // Lanes placing random carts against one shared inventory until it sells out. Afterwards
+    // the units in placed orders must equal the stock taken out of every product, and no
+    // quantity may be negative.
+    static bool checkoutLanes() {
+        const int products = 2000, unitsEach = 1000, cartsPerLane = 20000;
+        cout << "Checkout lanes: " << cartsPerLane << " carts per lane, " << products << " products of "
+             << unitsEach << " units, " << thread::hardware_concurrency() << " hardware threads\n";
+        bool passed = true;
+        double baseline = 0;
+        for (unsigned lanes : {1u, 2u, 4u, 8u, 16u, 32u}) {
+            InventoryManagement inventory;
+            inventory.reserveProducts(products);
+            for (int ID = 1; ID <= products; ID++) {
+                inventory.insertProduct(ID, unitsEach, StockAlerts::today() + 30, 0, Money::fromCents(250), Money::fromCents(150),
+                                        "Product " + to_string(ID), "Bench", "Acme", 0);
+            }
+            CheckoutAndOrderManager orders;
+            orders.attachInventory(&inventory);
+
+            vector<vector<int64_t>> sold(lanes, vector<int64_t>(products + 1, 0));
+            vector<size_t> placed(lanes, 0);
+            auto start = chrono::steady_clock::now();
+            vector<thread> workers;
+            for (unsigned lane = 0; lane < lanes; lane++) {
+                workers.emplace_back([&, lane]() {
+                    mt19937 random(lane + 1);
+                    for (int i = 0; i < cartsPerLane; i++) {
+                        vector<CartItem> cart;
+                        for (int line = 1 + random() % 3; line > 0; line--) {
+                            cart.push_back(CartItem(1 + random() % products, "Product", Money::fromCents(250), 1 + random() % 3, 0));
+                        }
+                        int shortID;
+                        if (!orders.placeOrder(cart, lane, shortID)) continue;
+                        placed[lane]++;
+                        for (const CartItem& item : cart) sold[lane][item.ID] += item.quantity;
+                    }
+                });
+            }
+            for (thread& worker : workers) worker.join();
+            double seconds = secondsSince(start);
+
+            size_t orderCount = 0;
+            for (size_t count : placed) orderCount += count;
+            bool consistent = orders.pendingCount() == orderCount;
+            for (int ID = 1; ID <= products; ID++) {
+                int64_t units = 0;
+                for (const auto& laneSales : sold) units += laneSales[ID];
+                int remaining = inventory.findProduct(ID)->quantity;
+                if (remaining < 0 || units != unitsEach - remaining) consistent = false;
+            }
+            passed &= consistent;
+
+            double rate = lanes * cartsPerLane / seconds;
+            if (lanes == 1) baseline = rate;
+            cout << "  lanes " << setw(2) << lanes << ": " << (int64_t)rate << " checkouts/s, x" << fixed << setprecision(2)
+                 << rate / baseline << defaultfloat << ", " << orderCount << " placed, oversell check "
+                 << (consistent ? "ok" : "FAILED") << "\n";
+        }
+        return passed;
+    }
+
+    // Totaling cart lines with Money against the same loop on raw doubles, plain and with a
+    // 15% discount per line (Money rounds each line to the cent). The Money total must
+    // equal the exact sum of cents; the double total shows how far it drifts.
+    static bool moneyTotals() {
+        const size_t lines = 1 << 20;
+        const int rounds = 20;
+        vector<Money> prices(lines);
+        vector<double> doublePrices(lines);
+        vector<int> quantities(lines);
+        mt19937 random(16);
+        int64_t exactCents = 0;
+        for (size_t i = 0; i < lines; i++) {
+            prices[i] = Money::fromCents(1 + random() % 5000);
+            doublePrices[i] = prices[i].toDouble();
+            quantities[i] = 1 + random() % 12;
+            exactCents += prices[i].minorUnits() * quantities[i];
+        }
+        cout << "Money vs double: " << lines << " cart lines, " << rounds << " rounds\n";
+
+        auto report = [&](const char* loop, double moneySeconds, double doubleSeconds) {
+            double perLine = 1e9 / ((double)lines * rounds);
+            cout << "  " << loop << ": Money " << fixed << setprecision(2) << moneySeconds * perLine << " ns/line, double "
+                 << doubleSeconds * perLine << " ns/line (x" << moneySeconds / doubleSeconds << ")" << defaultfloat
+                 << (moneySeconds > doubleSeconds ? ", Money SLOWER than double" : "") << "\n";
+        };
+
+        Money total;
+        auto start = chrono::steady_clock::now();
+        for (int round = 0; round < rounds; round++) {
+            for (size_t i = 0; i < lines; i++) total += prices[i] * quantities[i];
+        }
+        double moneySeconds = secondsSince(start);
+        double doubleTotal = 0;
+        start = chrono::steady_clock::now();
+        for (int round = 0; round < rounds; round++) {
+            for (size_t i = 0; i < lines; i++) doubleTotal += doublePrices[i] * quantities[i];
+        }
+        report("line totals", moneySeconds, secondsSince(start));
+        bool exact = total.minorUnits() == exactCents * rounds;
+        cout << "  Money total " << (exact ? "exact" : "WRONG") << ", double total off by "
+             << llround(doubleTotal * 100) - exactCents * rounds << " cents\n";
+
+        Money discounted;
+        start = chrono::steady_clock::now();
+        for (int round = 0; round < rounds; round++) {
+            for (size_t i = 0; i < lines; i++) discounted += prices[i].applyRate(8500) * quantities[i];
+        }
+        moneySeconds = secondsSince(start);
+        double doubleDiscounted = 0;
+        start = chrono::steady_clock::now();
+        for (int round = 0; round < rounds; round++) {
+            for (size_t i = 0; i < lines; i++) doubleDiscounted += doublePrices[i] * 0.85 * quantities[i];
+        }
+        report("15% off lines", moneySeconds, secondsSince(start));
+        if (discounted.isZero() || doubleDiscounted == 0) return false;  // Keeps both loops live
+        return exact;
+    }
+
+    // Type-ahead queries while a large catalog churns: rounds of adds and removals, each
+    // followed by a prefix and a typo-tolerant query, timed separately from the updates.
+    // Every query must find the last product added and none of the ones removed.
+    static bool searchChurn() {
+        const int products = 500000, rounds = 20, addsPerRound = 600, removalsPerRound = 300;
+        const char* words[] = {"fresh", "organic", "milk", "bread", "apple", "juice", "cola", "cheese",
+                               "butter", "tea", "coffee", "rice", "pasta", "sauce", "soap", "honey"};
+        ObjectPool<ItemNode> pool;
+        vector<ItemNode*> live;
+        ProductSearchEngine engine;
+        mt19937 random(4);
+        auto create = [&](int ID) {
+            string name = string(words[random() % 16]) + " " + words[random() % 16] + " " + to_string(ID);
+            live.push_back(pool.create(ID, 1, StockAlerts::today() + 30, 0, Money::fromCents(250), Money::fromCents(150), name,
+                                       "Bench", "Acme", (int)(random() % 1000)));
+            return live.back();
+        };
+        for (int ID = 1; ID <= products; ID++) engine.loadProduct(create(ID));
+        engine.compact();
+        cout << "Type-ahead under churn: " << products << " products, " << rounds << " rounds of " << addsPerRound
+             << " adds and " << removalsPerRound << " removals\n";
+
+        bool passed = true;
+        double worstQuery = 0, totalQuery = 0, worstUpdate = 0;
+        int nextID = products + 1;
+        for (int round = 0; round < rounds; round++) {
+            ItemNode* added = nullptr;
+            for (int i = 0; i < addsPerRound; i++) {
+                added = create(nextID++);
+                auto start = chrono::steady_clock::now();
+                engine.addProduct(added);
+                worstUpdate = max(worstUpdate, secondsSince(start));
+            }
+            string removedName;
+            int removedID = 0;
+            for (int i = 0; i < removalsPerRound; i++) {
+                size_t slot = random() % (live.size() - addsPerRound);  // Keep this round's adds
+                removedName = live[slot]->name;
+                removedID = live[slot]->ID;
+                auto start = chrono::steady_clock::now();
+                engine.removeProduct(removedID);
+                worstUpdate = max(worstUpdate, secondsSince(start));
+                pool.destroy(live[slot]);
+                live[slot] = live.back();
+                live.pop_back();
+            }
+
+            auto start = chrono::steady_clock::now();
+            vector<ItemNode*> prefix = engine.prefixSearch(words[round % 16], 10);
+            vector<ItemNode*> fuzzy = engine.fuzzySearch("chese", 10);
+            double seconds = secondsSince(start);
+            worstQuery = max(worstQuery, seconds);
+            totalQuery += seconds;
+
+            vector<ItemNode*> found = engine.prefixSearch(added->name, 10);
+            bool sawAdded = find(found.begin(), found.end(), added) != found.end();
+            bool sawRemoved = false;
+            for (ItemNode* item : engine.prefixSearch(removedName, 10)) sawRemoved |= item->ID == removedID;
+            if (prefix.size() != 10 || fuzzy.size() != 10 || !sawAdded || sawRemoved) passed = false;
+        }
+        for (ItemNode* item : live) pool.destroy(item);
+
+        cout << "  queries: worst " << fixed << setprecision(3) << worstQuery * 1000 << " ms, mean "
+             << totalQuery * 1000 / rounds << " ms; updates: worst " << worstUpdate * 1000 << " ms" << defaultfloat
+             << (passed ? "" : ", results WRONG") << "\n";
+        return passed;
+    }
+
+    // Journaled mutations on a real file with fsync per commit: bulk inserts in 512-record
+    // groups, then interactive updates that each commit on their own, then a replay of the
+    // whole log into an empty store, which must end with the same products and quantities.
+    static bool journalThroughput() {
+        const int products = 200000, updates = 2000;
+        string logPath = (filesystem::temp_directory_path() / "sms-bench.wal").string();
+        remove(logPath.c_str());
+        cout << "Write-ahead log: " << products << " inserts, " << updates << " updates, fsync per commit\n";
+        int64_t expiryDay = StockAlerts::today() + 30;
+        size_t records = 0;
+        {
+            InventoryManagement inventory;
+            inventory.reserveProducts(products);
+            WriteAheadLog journal;
+            if (!journal.open(logPath, WriteAheadLog::FSYNC_EVERY_COMMIT, 512, 0, 0)) {
+                cout << "  could not open " << logPath << "\n";
+                return false;
+            }
+            inventory.attachLog(&journal);
+            auto start = chrono::steady_clock::now();
+            for (int ID = 1; ID <= products; ID++) {
+                inventory.insertProduct(ID, 100, expiryDay, 0, Money::fromCents(250), Money::fromCents(150),
+                                        "Product " + to_string(ID), "Bench", "Acme", 0);
+            }
+            inventory.commitLog();
+            double seconds = secondsSince(start);
+            cout << "  inserts: " << (int64_t)(products / seconds) << " mutations/s\n";
+
+            streambuf* console = cout.rdbuf(nullptr);
+            start = chrono::steady_clock::now();
+            for (int i = 1; i <= updates; i++) {
+                inventory.updateProduct(i, "Product " + to_string(i), "Bench", 100 + i);
+            }
+            seconds = secondsSince(start);
+            cout.rdbuf(console);
+            cout << "  updates, one commit each: " << (int64_t)(updates / seconds) << " mutations/s\n";
+            records = products + updates;
+        }
+
+        InventoryManagement restored;
+        CheckoutAndOrderManager orders;
+        LoyaltyProgram loyalty;
+        uint64_t sequence = 0;
+        uintmax_t validLength;
+        auto start = chrono::steady_clock::now();
+        size_t applied = StoreRecovery::replayLog(logPath, sequence, validLength, restored, orders, loyalty);
+        double seconds = secondsSince(start);
+        remove(logPath.c_str());
+
+        bool passed = applied == records && restored.productCount() == (size_t)products;
+        for (int ID = 1; passed && ID <= products; ID++) {
+            const ItemNode* item = restored.findProduct(ID);
+            passed = item && item->quantity == (ID <= updates ? 100 + ID : 100);
+        }
+        cout << "  replay: " << (int64_t)(applied / seconds) << " records/s" << (passed ? "" : ", results WRONG") << "\n";
+        return passed;
+    }
+
+    // Chain-wide queries over a growing number of stores and query threads. Each store
+    // stocks (ID * 31 + store) % 100 units of every product, so both the stock of one SKU
+    // and the category report have known totals.
+    static bool storeScaling() {
+        const int maxStores = 400, products = 500, categories = 20, sku = 7;
+        const unsigned hardwareThreads = max(1u, thread::hardware_concurrency());
+        StoreNetwork chain(1);  // Owns the stores; each run attaches the first n to a fresh network
+        vector<InventoryManagement*> inventories;
+        for (int storeID = 1; storeID <= maxStores; storeID++) {
+            InventoryManagement* store = chain.addStore(storeID);
+            inventories.push_back(store);
+            store->reserveProducts(products);
+            store->deferSecondaryIndexes();
+            for (int ID = 1; ID <= products; ID++) {
+                store->insertProduct(ID, (ID * 31 + storeID) % 100, StockAlerts::today() + 30, 0, Money::fromCents(250),
+                                     Money::fromCents(150), "Product " + to_string(ID), "Category " + to_string(ID % categories),
+                                     "Acme", 0);
+            }
+        }
+        cout << "Store network: " << products << " products per store, " << hardwareThreads << " hardware threads\n";
+
+        bool passed = true;
+        for (int stores : {50, 100, 200, 400}) {
+            int64_t expectedSku = 0, expectedUnits = 0;
+            for (int storeID = 1; storeID <= stores; storeID++) {
+                expectedSku += (sku * 31 + storeID) % 100;
+                for (int ID = 1; ID <= products; ID++) expectedUnits += (ID * 31 + storeID) % 100;
+            }
+            for (unsigned threads : {1u, 4u, 16u}) {
+                StoreNetwork network(threads);
+                for (int storeID = 1; storeID <= stores; storeID++) network.attachStore(storeID, inventories[storeID - 1]);
+
+                const int lookups = 200, reports = 5;
+                int64_t skuTotal = 0;
+                auto start = chrono::steady_clock::now();
+                for (int i = 0; i < lookups; i++) skuTotal = network.totalStock(sku);
+                double lookupSeconds = secondsSince(start);
+                map<string, StoreNetwork::CategoryTotals> report;
+                start = chrono::steady_clock::now();
+                for (int i = 0; i < reports; i++) report = network.categoryReport();
+                double reportSeconds = secondsSince(start);
+
+                int64_t units = 0;
+                for (const auto& entry : report) units += entry.second.units;
+                bool consistent = skuTotal == expectedSku && units == expectedUnits && report.size() == (size_t)categories;
+                passed &= consistent;
+                cout << "  stores " << setw(3) << stores << ", threads " << setw(2) << threads << ": total stock of SKU "
+                     << fixed << setprecision(3) << lookupSeconds * 1000 / lookups << " ms, category report "
+                     << reportSeconds * 1000 / reports << " ms" << defaultfloat << (consistent ? "" : ", totals WRONG") << "\n";
+            }
+        }
+        return passed;
+    }
+
+public:
+    static int run() {
+        bool passed = true;
+        passed &= checkoutLanes();
+        passed &= moneyTotals();
+        passed &= searchChurn();
+        passed &= journalThroughput();
+        passed &= storeScaling();
+        return passed ? 0 : 1;
+    }
+};
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && string(argv[1]) == "--check") return RegressionChecks::run();
+    if (argc > 1 && string(argv[1]) == "--bench") return Benchmarks::run();
+
     InventoryManagement inventoryManager;
     ShoppingCart shoppingCart;
     CheckoutAndOrderManager orderManager;
@@ -783,22 +7204,73 @@ int main() {
     PromotionsAndDiscounts promotions;
     LoyaltyProgram loyaltyProgram;
 
+    OperationLog operationLog;
+    if (!operationLog.start("supermarket.log", chrono::milliseconds(500))) {
+        cout << "Warning: could not open supermarket.log; operations are kept in memory only.\n";
+    }
+    analytics.attachOperationLog(&operationLog);
+    orderManager.attachOperationLog(&operationLog);
+    orderManager.attachSalesAggregator(&analytics.sales());
+    analytics.attachInventory(&inventoryManager);
+    inventoryManager.stockAlerts().attachOperationLog(&operationLog);
+
+    DemandTracker demandTracker;
+    DynamicPricingScheduler pricingScheduler(demandTracker, inventoryManager, promotions);
+    orderManager.attachInventory(&inventoryManager);
+    orderManager.attachDemandTracker(&demandTracker);
+
+    const string snapshotPath = "supermarket.snap";
+    const string logPath = "supermarket.wal";
+    uint64_t logSequence = 0;
+    uintmax_t validLogLength = 0;
+    if (StoreSnapshot::load(snapshotPath, logSequence, inventoryManager, orderManager, loyaltyProgram)) {
+        cout << "Restored " << inventoryManager.productCount() << " products from " << snapshotPath << ".\n";
+    }
+    size_t replayed = StoreRecovery::replayLog(logPath, logSequence, validLogLength, inventoryManager, orderManager, loyaltyProgram);
+    if (replayed) {
+        cout << "Recovered " << replayed << " changes from " << logPath << ".\n";
+    }
+
+    WriteAheadLog journal;
+    if (journal.open(logPath, WriteAheadLog::FSYNC_EVERY_COMMIT, 64, logSequence, validLogLength)) {
+        inventoryManager.attachLog(&journal);
+        orderManager.attachLog(&journal);
+        loyaltyProgram.attachLog(&journal);
+    } else {
+        cout << "Warning: could not open " << logPath << "; changes are only saved on exit.\n";
+    }
+
+    pricingScheduler.runPass();  // Restored sell prices are list prices until the first pass
+    pricingScheduler.start(chrono::seconds(60));
+
     int userType;
     cout << "Welcome to the Supermarket Management System\n";
     cout << "Are you an:\n1. Admin\n2. Customer\nChoose an option: ";
     cin >> userType;
 
     if (userType == 1) {
-        AdminWorkflow adminWorkflow(inventoryManager, analytics, promotions);
+        StoreNetwork storeNetwork;
+        storeNetwork.attachStore(1, &inventoryManager);  // This store
+        AdminWorkflow adminWorkflow(inventoryManager, analytics, promotions, orderManager, pricingScheduler, storeNetwork);
         adminWorkflow.start();
     } else if (userType == 2) {
         // Add a sample customer profile for demonstration
-        loyaltyProgram.addCustomerProfile(1, "John Doe");
-        CustomerWorkflow customerWorkflow(shoppingCart, orderManager, loyaltyProgram);
+        if (!loyaltyProgram.hasCustomer(1)) {
+            loyaltyProgram.addCustomerProfile(1, "John Doe");
+        }
+        CustomerWorkflow customerWorkflow(shoppingCart, orderManager, loyaltyProgram, promotions);
         customerWorkflow.start();
     } else {
         cout << "Invalid user type. Exiting the system.\n";
     }
 
+    pricingScheduler.stop();
+    operationLog.stop();
+    journal.commit();
+    if (StoreSnapshot::save(snapshotPath, journal.sequence(), inventoryManager, orderManager, loyaltyProgram)) {
+        journal.reset(logPath);
+    } else {
+        cout << "Failed to save snapshot to " << snapshotPath << ".\n";
+    }
     return 0;
 }